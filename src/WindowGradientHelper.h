@@ -21,6 +21,7 @@
 
 #import <Cocoa/Cocoa.h>
 #include "nsNativeThemeColors.h"
+#include "quartz-cache.h"
 
 @interface WindowGradientHelper : NSColor {
 	NSWindow* wnd;
@@ -42,4 +43,7 @@
 + (CGGradientRef) inactiveTitle;
 + (CGGradientRef) activeStatus;
 + (CGGradientRef) inactiveStatus;
++ (CGImageRef) stripForGradient: (CGGradientRef)gradient height: (CGFloat)height scale: (unsigned int)scale;
++ (void) initStripKey: (QuartzCacheKey*)key gradient: (CGGradientRef)gradient height: (CGFloat)height scale: (unsigned int)scale;
++ (CGImageRef) renderStripForGradient: (CGGradientRef)gradient key: (const QuartzCacheKey*)key;
 @end 
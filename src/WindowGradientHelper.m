@@ -24,7 +24,11 @@
  See http://hg.mozilla.org/mozilla-central/raw-file/d3537bbc4e6a/widget/src/cocoa/nsCocoaWindow.mm
  */
 
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+
 #import "WindowGradientHelper.h"
+#include "quartz-cache.h"
 
 static CGGradientRef aTitle, iTitle, aStatus, iStatus;
 
@@ -74,8 +78,23 @@ static void PatternCallback (void* aInfo, CGContextRef aContext)
 	float frameHeight = [[wgh window] frame].size.height;
 	float gradientHeight = [WindowGradientHelper titleBarHeight] + [wgh toolbarHeight];
 	
+	CGGradientRef gradient = isMain? [WindowGradientHelper activeTitle] : [WindowGradientHelper inactiveTitle];
+	CGImageRef strip = NULL;
+
+	// the pattern is recreated for every height, so reuse the gradient strip while resizing
+	if ([[wgh window] inLiveResize]) {
+		guint scale = 1;
+		if ([[wgh window] respondsToSelector: @selector(backingScaleFactor)])
+			scale = MAX (1, (guint) [[wgh window] backingScaleFactor]);
+		strip = [WindowGradientHelper stripForGradient: gradient height: gradientHeight scale: scale];
+	}
+
 	// draw toolbar gradient
-	CGContextDrawLinearGradient (aContext, isMain? [WindowGradientHelper activeTitle] : [WindowGradientHelper inactiveTitle], CGPointMake (0.0f, frameHeight), CGPointMake (0.0f, frameHeight - gradientHeight), 0);
+	if (strip) {
+		CGContextDrawImage (aContext, CGRectMake (0.0f, frameHeight - gradientHeight, 1.0f, gradientHeight), strip);
+		CGImageRelease (strip);
+	} else
+		CGContextDrawLinearGradient (aContext, gradient, CGPointMake (0.0f, frameHeight), CGPointMake (0.0f, frameHeight - gradientHeight), 0);
 	
 	// draw statusbar gradient (if there is one)
 	// Not needed? Gtk will always overdraw this i think
@@ -156,6 +175,58 @@ static void PatternCallback (void* aInfo, CGContextRef aContext)
 	CGColorSpaceRelease (cs);	
 }
 
+static void RenderStrip (CGContextRef context, const HIRect* rect, gpointer user_data)
+{
+	CGContextClipToRect (context, *rect);
+	CGContextDrawLinearGradient (context, (CGGradientRef)user_data, CGPointMake (0.0f, rect->origin.y), CGPointMake (0.0f, CGRectGetMaxY (*rect)), 0);
+}
+
+// A one pixel wide column of one of the gradients, with the start color at the top. Since
+// the gradients are purely vertical, stretching it to the window width gives the same result
+// as drawing the gradient, without recomputing it for every size. The caller owns the strip.
++ (CGImageRef) stripForGradient: (CGGradientRef)gradient height: (CGFloat)height scale: (unsigned int)scale
+{
+	QuartzCacheKey key;
+	CGImageRef image;
+
+	[WindowGradientHelper initStripKey: &key gradient: gradient height: height scale: scale];
+
+	image = quartz_cache_lookup (&key);
+	if (image)
+		return image;
+
+	image = [WindowGradientHelper renderStripForGradient: gradient key: &key];
+	if (image)
+		quartz_cache_insert (&key, CGImageRetain (image));
+
+	return image;
+}
+
++ (void) initStripKey: (QuartzCacheKey*)key gradient: (CGGradientRef)gradient height: (CGFloat)height scale: (unsigned int)scale
+{
+	HIRect rect = CGRectMake (0.0f, 0.0f, 1.0f, height);
+
+	quartz_cache_key_init_for_scale (key, QUARTZ_CACHE_GRADIENT, scale, &rect);
+	key->kind = gradient == aTitle ? 0 : gradient == iTitle ? 1 : gradient == aStatus ? 2 : 3;
+}
+
+// Renders the strip for key without touching the cache, so the prerender threads can use it too.
++ (CGImageRef) renderStripForGradient: (CGGradientRef)gradient key: (const QuartzCacheKey*)key
+{
+	CGImageRef image, source;
+
+	source = quartz_cache_render_image (key, RenderStrip, gradient);
+	if (!source)
+		return NULL;
+
+	// cut off the padding, the strip gets stretched
+	image = CGImageCreateWithImageInRect (source, CGRectMake (QUARTZ_CACHE_PADDING * key->scale, QUARTZ_CACHE_PADDING * key->scale,
+															  key->width * key->scale, key->height * key->scale));
+	CGImageRelease (source);
+
+	return image;
+}
+
 + (CGGradientRef) activeTitle { return aTitle; }
 + (CGGradientRef) inactiveTitle { return iTitle; }
 + (CGGradientRef) activeStatus { return aStatus; }
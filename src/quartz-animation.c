@@ -0,0 +1,227 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* A single frame clock shared by everything the engine animates. Each
+ * tick bumps the frame counter and invalidates just the rects that were
+ * registered, and the timeout goes away when nothing is left to animate.
+ */
+
+#include <config.h>
+
+#include "quartz-animation.h"
+
+typedef struct
+{
+  GtkWidget           *widget;
+  GdkWindow           *window;  /* owned, may outlive the widget's realization */
+  GdkRectangle         rect;
+  QuartzAnimationFunc  func;
+  gboolean             paused;
+} AnimationInfo;
+
+static GSList *animations = NULL;
+static guint   timeout_id = 0;
+static guint   timeout_fps = 0;
+static guint   frame = 0;
+static guint   fps = QUARTZ_ANIMATION_DEFAULT_FPS;
+
+static gboolean animation_tick (gpointer data);
+
+static void
+start_clock (guint rate)
+{
+  if (timeout_id && timeout_fps == rate)
+    return;
+
+  if (timeout_id)
+    g_source_remove (timeout_id);
+
+  timeout_fps = rate;
+  timeout_id = g_timeout_add (1000 / rate, animation_tick, NULL);
+}
+
+static AnimationInfo *
+lookup_animation (GtkWidget *widget)
+{
+  GSList *l;
+
+  for (l = animations; l; l = l->next)
+    {
+      AnimationInfo *info = l->data;
+
+      if (info->widget == widget)
+        return info;
+    }
+
+  return NULL;
+}
+
+static void
+widget_destroyed (gpointer  data,
+                  GObject  *object)
+{
+  AnimationInfo *info;
+
+  info = lookup_animation (GTK_WIDGET (object));
+  if (!info)
+    return;
+
+  animations = g_slist_remove (animations, info);
+  g_object_unref (info->window);
+  g_free (info);
+}
+
+static void
+free_animation (AnimationInfo *info)
+{
+  animations = g_slist_remove (animations, info);
+  g_object_weak_unref (G_OBJECT (info->widget), widget_destroyed, NULL);
+  g_object_unref (info->window);
+  g_free (info);
+}
+
+static gboolean
+animation_tick (gpointer data)
+{
+  GSList *l, *next;
+  gboolean running = FALSE;
+
+  frame++;
+
+  for (l = animations; l; l = next)
+    {
+      AnimationInfo *info = l->data;
+      QuartzAnimationState state;
+
+      next = l->next;
+
+      if (!GTK_WIDGET_MAPPED (info->widget) ||
+          !gdk_window_is_viewable (info->window))
+        state = QUARTZ_ANIMATION_STOP;
+      else if (info->func)
+        state = info->func (info->widget);
+      else
+        state = QUARTZ_ANIMATION_RUN;
+
+      if (state == QUARTZ_ANIMATION_STOP)
+        {
+          free_animation (info);
+          continue;
+        }
+
+      if (state == QUARTZ_ANIMATION_SKIP)
+        {
+          info->paused = FALSE;
+          running = TRUE;
+          continue;
+        }
+
+      /* Redraw once more when pausing, to get the resting frame. */
+      if (state == QUARTZ_ANIMATION_RUN || !info->paused)
+        gdk_window_invalidate_rect (info->window, &info->rect, FALSE);
+
+      info->paused = (state == QUARTZ_ANIMATION_PAUSE);
+      running |= !info->paused;
+    }
+
+  if (!animations)
+    {
+      timeout_id = 0;
+      return FALSE;
+    }
+
+  /* Don't wake up at full rate if everything is paused. */
+  if (running && timeout_fps != fps)
+    {
+      timeout_id = 0;
+      start_clock (fps);
+      return FALSE;
+    }
+  else if (!running && timeout_fps != QUARTZ_ANIMATION_IDLE_FPS)
+    {
+      timeout_id = 0;
+      start_clock (QUARTZ_ANIMATION_IDLE_FPS);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+quartz_animation_set_fps (guint new_fps)
+{
+  fps = CLAMP (new_fps, 1, 120);
+
+  if (timeout_id && timeout_fps != QUARTZ_ANIMATION_IDLE_FPS)
+    start_clock (fps);
+}
+
+guint
+quartz_animation_get_frame (void)
+{
+  return frame;
+}
+
+/* Registers rect of window to be redrawn on every tick for as long as
+ * widget is mapped and func doesn't stop it. Calling this again for
+ * the same widget just updates the rect.
+ */
+void
+quartz_animation_add (GtkWidget           *widget,
+                      GdkWindow           *window,
+                      const GdkRectangle  *rect,
+                      QuartzAnimationFunc  func)
+{
+  AnimationInfo *info;
+
+  info = lookup_animation (widget);
+  if (!info)
+    {
+      info = g_new0 (AnimationInfo, 1);
+      info->widget = widget;
+      g_object_weak_ref (G_OBJECT (widget), widget_destroyed, NULL);
+
+      animations = g_slist_prepend (animations, info);
+    }
+
+  /* Held so that a tick after the widget got unrealized doesn't touch
+   * a destroyed window.
+   */
+  g_object_ref (window);
+  if (info->window)
+    g_object_unref (info->window);
+  info->window = window;
+
+  info->rect = *rect;
+  info->func = func;
+
+  if (!timeout_id)
+    start_clock (fps);
+}
+
+void
+quartz_animation_remove (GtkWidget *widget)
+{
+  AnimationInfo *info;
+
+  info = lookup_animation (widget);
+  if (info)
+    free_animation (info);
+}
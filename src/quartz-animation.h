@@ -0,0 +1,53 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_ANIMATION_H
+#define QUARTZ_ANIMATION_H
+
+#include <gtk/gtk.h>
+
+#define QUARTZ_ANIMATION_DEFAULT_FPS 30
+
+/* While every animation is paused the clock only polls at this rate. */
+#define QUARTZ_ANIMATION_IDLE_FPS 2
+
+typedef enum {
+  QUARTZ_ANIMATION_STOP,
+  QUARTZ_ANIMATION_PAUSE,
+  QUARTZ_ANIMATION_RUN,
+  QUARTZ_ANIMATION_SKIP
+} QuartzAnimationState;
+
+/* Called on every tick. Paused widgets keep their registration but
+ * aren't redrawn, stopped ones are dropped. Skipping widgets are still
+ * running but have nothing new to show on this tick.
+ */
+typedef QuartzAnimationState (* QuartzAnimationFunc) (GtkWidget *widget);
+
+void  quartz_animation_set_fps   (guint                fps);
+guint quartz_animation_get_frame (void);
+
+void  quartz_animation_add       (GtkWidget           *widget,
+                                  GdkWindow           *window,
+                                  const GdkRectangle  *rect,
+                                  QuartzAnimationFunc  func);
+void  quartz_animation_remove    (GtkWidget           *widget);
+
+#endif /* QUARTZ_ANIMATION_H */
@@ -0,0 +1,557 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Keeps the render cache across launches. The cached images are
+ * written to a file when things have settled down and at exit, and
+ * the file is mapped read-only at startup so that the images can be
+ * used directly from the page cache.
+ *
+ * The file is only meant to be read back by the same engine on the
+ * same machine, so everything is stored in host byte order. It is
+ * thrown away when the rendering version, the system version, the
+ * appearance or the system colors differ, or when the checksum
+ * doesn't match.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <Carbon/Carbon.h>
+#include <AppKit/AppKit.h>
+
+#include "quartz-cache.h"
+#include "quartz-cache-file.h"
+
+#define CACHE_FILE_MAGIC   "QZCACHE"
+#define CACHE_FILE_FORMAT  2
+#define CACHE_FILE_ALIGN   16
+
+/* Milliseconds without new images before the file is written. */
+#define SAVE_DELAY 5000
+
+#define BITMAP_INFO (kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host)
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 format;
+  guint32 key_size;
+  guint32 render_version;
+  gchar   system_version[48];
+  gchar   appearance[32];
+  guint32 palette;
+  guint32 n_records;
+  guint32 data_size;       /* everything after the header */
+  guint32 checksum;        /* of data_size bytes after the header */
+} FileHeader;
+
+typedef struct
+{
+  QuartzCacheKey key;
+  guint32        width;
+  guint32        height;
+  guint32        bytes_per_row;
+  guint32        offset;   /* from the start of the file */
+} FileRecord;
+
+/* Images created from the file point into the mapping, so it stays
+ * around until the last of them is released.
+ */
+typedef struct
+{
+  gpointer      data;
+  gsize         size;
+  volatile gint ref_count;
+} Mapping;
+
+static gchar    *filename = NULL;
+static guint     save_timeout_id = 0;
+static gboolean  dirty = FALSE;
+
+static guint32
+checksum_update (guint32       sum,
+                 const guchar *data,
+                 gsize         len)
+{
+  gsize i;
+
+  /* FNV-1a */
+  for (i = 0; i < len; i++)
+    sum = (sum ^ data[i]) * 16777619;
+
+  return sum;
+}
+
+#define CHECKSUM_INIT 2166136261U
+
+/* Everything the cached images depend on besides their key. */
+static guint32
+get_palette (void)
+{
+  NSColor *color;
+  CGFloat r, g, b, a;
+  guint32 palette;
+
+  palette = [NSColor currentControlTint] << 24;
+
+  color = [[NSColor selectedControlColor] colorUsingColorSpaceName: NSCalibratedRGBColorSpace];
+  if (color)
+    {
+      [color getRed: &r green: &g blue: &b alpha: &a];
+      palette ^= ((guint32) (r * 255) << 16) |
+                 ((guint32) (g * 255) << 8) |
+                 (guint32) (b * 255);
+    }
+
+  return palette;
+}
+
+/* HITheme draws differently between releases, even minor ones, so
+ * the build is part of this.
+ */
+static void
+get_system_version (gchar *version,
+                    gsize  size)
+{
+  NSString *string;
+
+  string = [[NSProcessInfo processInfo] operatingSystemVersionString];
+  if (string)
+    g_strlcpy (version, [string UTF8String], size);
+
+  snprintf (version + strlen (version), size - strlen (version),
+            " AppKit %g", NSAppKitVersionNumber);
+}
+
+static void
+get_appearance (gchar *appearance,
+                gsize  size)
+{
+  NSString *name = nil;
+
+  if ([NSApp respondsToSelector: @selector(effectiveAppearance)])
+    name = [[NSApp performSelector: @selector(effectiveAppearance)] name];
+  if (!name)
+    name = [[NSUserDefaults standardUserDefaults] stringForKey: @"AppleInterfaceStyle"];
+  if (!name)
+    name = @"Aqua";
+
+  g_strlcpy (appearance, [name UTF8String], size);
+}
+
+static void
+header_init (FileHeader *header)
+{
+  memset (header, 0, sizeof (FileHeader));
+
+  strncpy (header->magic, CACHE_FILE_MAGIC, sizeof (header->magic));
+  header->format = CACHE_FILE_FORMAT;
+  header->key_size = sizeof (QuartzCacheKey);
+  header->render_version = QUARTZ_CACHE_RENDER_VERSION;
+  get_system_version (header->system_version, sizeof (header->system_version));
+  get_appearance (header->appearance, sizeof (header->appearance));
+  header->palette = get_palette ();
+}
+
+static void
+mapping_unref (Mapping *mapping)
+{
+  if (g_atomic_int_dec_and_test (&mapping->ref_count))
+    {
+      munmap (mapping->data, mapping->size);
+      g_free (mapping);
+    }
+}
+
+static void
+release_image_data (void       *info,
+                    const void *data,
+                    size_t      size)
+{
+  mapping_unref (info);
+}
+
+static gboolean
+header_is_valid (const guchar *data,
+                 gsize         size)
+{
+  const FileHeader *header = (const FileHeader *) data;
+  FileHeader expected;
+
+  if (size < sizeof (FileHeader))
+    return FALSE;
+
+  header_init (&expected);
+
+  if (memcmp (header->magic, expected.magic, sizeof (expected.magic)) != 0 ||
+      header->format != expected.format ||
+      header->key_size != expected.key_size ||
+      header->render_version != expected.render_version ||
+      memcmp (header->system_version, expected.system_version,
+              sizeof (expected.system_version)) != 0 ||
+      memcmp (header->appearance, expected.appearance,
+              sizeof (expected.appearance)) != 0 ||
+      header->palette != expected.palette)
+    return FALSE;
+
+  if (header->data_size != size - sizeof (FileHeader) ||
+      header->n_records > header->data_size / sizeof (FileRecord))
+    return FALSE;
+
+  return checksum_update (CHECKSUM_INIT, data + sizeof (FileHeader),
+                          header->data_size) == header->checksum;
+}
+
+static CGImageRef
+create_image (Mapping          *mapping,
+              const FileRecord *record)
+{
+  CGColorSpaceRef colorspace;
+  CGDataProviderRef provider;
+  CGImageRef image;
+  gsize size;
+
+  size = (gsize) record->bytes_per_row * record->height;
+
+  if (record->width == 0 || record->height == 0 ||
+      record->bytes_per_row < record->width * 4 ||
+      record->offset % 4 != 0 ||
+      record->offset > mapping->size ||
+      size > mapping->size - record->offset)
+    return NULL;
+
+  g_atomic_int_inc (&mapping->ref_count);
+  provider = CGDataProviderCreateWithData (mapping,
+                                           (guchar *) mapping->data + record->offset,
+                                           size, release_image_data);
+
+  colorspace = CGColorSpaceCreateDeviceRGB ();
+  image = CGImageCreate (record->width, record->height, 8, 32,
+                         record->bytes_per_row, colorspace, BITMAP_INFO,
+                         provider, NULL, false, kCGRenderingIntentDefault);
+  CGColorSpaceRelease (colorspace);
+  CGDataProviderRelease (provider);
+
+  return image;
+}
+
+static void
+load (void)
+{
+  const FileHeader *header;
+  const FileRecord *records;
+  Mapping *mapping;
+  CGImageRef image;
+  struct stat st;
+  gpointer data;
+  gint fd;
+  guint i;
+
+  fd = g_open (filename, O_RDONLY, 0);
+  if (fd < 0)
+    return;
+
+  if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (FileHeader))
+    {
+      close (fd);
+      return;
+    }
+
+  data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (data == MAP_FAILED)
+    return;
+
+  mapping = g_new (Mapping, 1);
+  mapping->data = data;
+  mapping->size = st.st_size;
+  mapping->ref_count = 1;
+
+  if (!header_is_valid (data, st.st_size))
+    {
+      mapping_unref (mapping);
+      return;
+    }
+
+  header = data;
+  records = (const FileRecord *) (header + 1);
+
+  /* Records are stored most recently used first, insert them the
+   * other way around to end up with the same order.
+   */
+  for (i = header->n_records; i > 0; i--)
+    {
+      image = create_image (mapping, &records[i - 1]);
+      if (image)
+        quartz_cache_insert (&records[i - 1].key, image);
+    }
+
+  mapping_unref (mapping);
+}
+
+typedef struct
+{
+  GArray    *records;
+  GPtrArray *images;
+} SaveData;
+
+static void
+collect_image (const QuartzCacheKey *key,
+               CGImageRef            image,
+               gpointer              user_data)
+{
+  SaveData *save = user_data;
+  FileRecord record;
+
+  memset (&record, 0, sizeof (FileRecord));
+  record.key = *key;
+  record.width = CGImageGetWidth (image);
+  record.height = CGImageGetHeight (image);
+  record.bytes_per_row = record.width * 4;
+
+  g_array_append_val (save->records, record);
+  g_ptr_array_add (save->images, (gpointer) CGImageRetain (image));
+}
+
+static gsize
+align (gsize offset)
+{
+  return (offset + CACHE_FILE_ALIGN - 1) & ~(gsize) (CACHE_FILE_ALIGN - 1);
+}
+
+/* Images in the cache can be subimages of a larger bitmap, so each
+ * one is drawn into a tightly packed bitmap of its own first.
+ */
+static gboolean
+write_image (FILE       *file,
+             CGImageRef  image,
+             FileRecord *record,
+             guint32    *checksum)
+{
+  CGColorSpaceRef colorspace;
+  CGContextRef context;
+  gboolean success;
+  gsize size;
+
+  colorspace = CGColorSpaceCreateDeviceRGB ();
+  context = CGBitmapContextCreate (NULL, record->width, record->height, 8,
+                                   record->bytes_per_row, colorspace, BITMAP_INFO);
+  CGColorSpaceRelease (colorspace);
+
+  if (!context)
+    return FALSE;
+
+  CGContextSetBlendMode (context, kCGBlendModeCopy);
+  CGContextDrawImage (context, CGRectMake (0, 0, record->width, record->height), image);
+
+  size = (gsize) record->bytes_per_row * record->height;
+  success = fwrite (CGBitmapContextGetData (context), 1, size, file) == size;
+  *checksum = checksum_update (*checksum, CGBitmapContextGetData (context), size);
+
+  CGContextRelease (context);
+
+  return success;
+}
+
+static gboolean
+write_padding (FILE    *file,
+               gsize    len,
+               guint32 *checksum)
+{
+  static const guchar zeros[CACHE_FILE_ALIGN] = { 0 };
+
+  *checksum = checksum_update (*checksum, zeros, len);
+
+  return fwrite (zeros, 1, len, file) == len;
+}
+
+static void
+save (void)
+{
+  FileHeader header;
+  FileRecord *record;
+  SaveData data;
+  gchar *tmp;
+  FILE *file;
+  gsize offset;
+  guint32 checksum;
+  gboolean success;
+  guint i;
+
+  dirty = FALSE;
+
+  data.records = g_array_new (FALSE, FALSE, sizeof (FileRecord));
+  data.images = g_ptr_array_new ();
+  quartz_cache_foreach (collect_image, &data);
+
+  header_init (&header);
+  header.n_records = data.records->len;
+
+  offset = align (sizeof (FileHeader) + data.records->len * sizeof (FileRecord));
+  for (i = 0; i < data.records->len; i++)
+    {
+      record = &g_array_index (data.records, FileRecord, i);
+      record->offset = offset;
+      offset = align (offset + (gsize) record->bytes_per_row * record->height);
+    }
+
+  header.data_size = offset - sizeof (FileHeader);
+
+  tmp = g_strconcat (filename, ".tmp", NULL);
+  file = g_fopen (tmp, "wb");
+  success = file != NULL;
+
+  if (success)
+    {
+      checksum = CHECKSUM_INIT;
+      offset = sizeof (FileHeader);
+
+      success = fwrite (&header, sizeof (FileHeader), 1, file) == 1;
+
+      if (success && data.records->len)
+        {
+          success = fwrite (data.records->data, sizeof (FileRecord),
+                            data.records->len, file) == data.records->len;
+          checksum = checksum_update (checksum, (guchar *) data.records->data,
+                                      data.records->len * sizeof (FileRecord));
+          offset += data.records->len * sizeof (FileRecord);
+        }
+
+      for (i = 0; success && i < data.records->len; i++)
+        {
+          record = &g_array_index (data.records, FileRecord, i);
+
+          success = write_padding (file, record->offset - offset, &checksum) &&
+                    write_image (file, g_ptr_array_index (data.images, i), record, &checksum);
+          offset = record->offset + (gsize) record->bytes_per_row * record->height;
+        }
+
+      if (success)
+        success = write_padding (file, sizeof (FileHeader) + header.data_size - offset, &checksum);
+
+      if (success)
+        {
+          header.checksum = checksum;
+          success = fseek (file, 0, SEEK_SET) == 0 &&
+                    fwrite (&header, sizeof (FileHeader), 1, file) == 1;
+        }
+
+      if (fclose (file) != 0)
+        success = FALSE;
+    }
+
+  /* Write to a temporary file first so that a crash never leaves a
+   * half written file behind, and so that images still mapped from
+   * the old file aren't overwritten.
+   */
+  if (success)
+    success = g_rename (tmp, filename) == 0;
+  if (!success)
+    {
+      g_warning ("quartz-engine: could not write cache file %s: %s",
+                 filename, g_strerror (errno));
+      g_unlink (tmp);
+    }
+
+  g_free (tmp);
+
+  for (i = 0; i < data.images->len; i++)
+    CGImageRelease (g_ptr_array_index (data.images, i));
+  g_ptr_array_free (data.images, TRUE);
+  g_array_free (data.records, TRUE);
+}
+
+static gboolean
+save_timeout (gpointer data)
+{
+  save_timeout_id = 0;
+  save ();
+
+  return FALSE;
+}
+
+static void
+cache_changed (void)
+{
+  dirty = TRUE;
+
+  /* Wait until no new images show up for a while. */
+  if (save_timeout_id)
+    g_source_remove (save_timeout_id);
+  save_timeout_id = g_timeout_add_full (G_PRIORITY_LOW, SAVE_DELAY,
+                                        save_timeout, NULL, NULL);
+}
+
+/* Loads the images saved in path by an earlier run, if they are still
+ * valid, and keeps path up to date from then on.
+ */
+void
+quartz_cache_file_init (const gchar *path)
+{
+  GTimer *timer;
+
+  if (filename)
+    return;
+
+  filename = g_strdup (path);
+
+  timer = g_timer_new ();
+  load ();
+
+  if (g_getenv ("QUARTZ_CACHE_STATS"))
+    g_print ("quartz-engine cache: loaded %lu bytes from %s in %.2f ms\n",
+             (gulong) quartz_cache_get_resident_bytes (), filename,
+             g_timer_elapsed (timer, NULL) * 1000);
+  g_timer_destroy (timer);
+
+  quartz_cache_set_changed_func (cache_changed);
+}
+
+/* Writes any images that were added since the last save. Must be
+ * called before the cache itself is shut down.
+ */
+void
+quartz_cache_file_shutdown (void)
+{
+  if (!filename)
+    return;
+
+  quartz_cache_set_changed_func (NULL);
+
+  if (save_timeout_id)
+    {
+      g_source_remove (save_timeout_id);
+      save_timeout_id = 0;
+    }
+
+  if (dirty)
+    save ();
+
+  g_free (filename);
+  filename = NULL;
+}
@@ -0,0 +1,654 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* A cache of pre-rendered HITheme images. Controls that are drawn
+ * many times with the same parameters (cell checkboxes, headers, ...)
+ * are rasterized once into a bitmap and then just blitted.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+#include <AppKit/AppKit.h>
+
+#include "quartz-cache.h"
+
+/* FIXME: Fix GTK+ to export those in a quartz header file. */
+NSWindow *   gdk_quartz_window_get_nswindow (GdkWindow *window);
+
+/* Used when the rc files don't set a cachesize. */
+#define DEFAULT_BUDGET (8 * 1024 * 1024)
+
+/* Images bigger than this share of the budget aren't kept, they would
+ * push out everything else and could even exceed the budget on their
+ * own. Callers just draw them and let them go.
+ */
+#define MAX_ENTRY_SHARE 4
+
+typedef struct
+{
+  QuartzCacheKey key;
+  CGImageRef     image;
+  gsize          bytes;
+  gboolean       speculative;
+  GList          link;
+} CacheEntry;
+
+static GHashTable *cache = NULL;
+
+/* Most recently used entries are at the head. */
+static GQueue      lru = { NULL, NULL, 0 };
+static gsize       budget = DEFAULT_BUDGET;
+static gsize       resident_bytes = 0;
+static volatile gint generation = 0;
+
+static QuartzCacheChangedFunc changed_func = NULL;
+
+/* Set from QUARTZ_CACHE_DISABLE or by tests. Nothing is rendered into or looked up
+ * from the cache then, so every caller takes its direct drawing path.
+ * Useful to compare screenshots with and without the cache.
+ */
+static gboolean disabled = FALSE;
+
+static struct
+{
+  guint speculative;
+  guint speculative_used;
+  guint evictions;
+} stats;
+
+static void
+free_entry (CacheEntry *entry)
+{
+  g_queue_unlink (&lru, &entry->link);
+  resident_bytes -= entry->bytes;
+
+  CGImageRelease (entry->image);
+  g_free (entry);
+}
+
+static void
+evict (gsize needed)
+{
+  CacheEntry *entry;
+
+  while (lru.tail && resident_bytes + needed > budget)
+    {
+      entry = lru.tail->data;
+      g_hash_table_remove (cache, &entry->key);
+      stats.evictions++;
+    }
+}
+
+/* Hash and equality functions for QuartzCacheKey, for any table keyed
+ * by them.
+ */
+guint
+quartz_cache_key_hash (gconstpointer v)
+{
+  const guint *p = v;
+  guint h = 0;
+  gint i;
+
+  for (i = 0; i < sizeof (QuartzCacheKey) / sizeof (guint); i++)
+    h = (h << 5) - h + p[i];
+
+  return h;
+}
+
+gboolean
+quartz_cache_key_equal (gconstpointer a,
+                        gconstpointer b)
+{
+  return memcmp (a, b, sizeof (QuartzCacheKey)) == 0;
+}
+
+guint
+quartz_cache_get_scale (GdkWindow *window)
+{
+  NSWindow *wnd;
+
+  if (!window || GDK_IS_PIXMAP (window))
+    return 1;
+
+  wnd = gdk_quartz_window_get_nswindow (window);
+  if (wnd && [wnd respondsToSelector: @selector(backingScaleFactor)])
+    return MAX (1, (guint) [wnd backingScaleFactor]);
+
+  return 1;
+}
+
+void
+quartz_cache_key_init_for_scale (QuartzCacheKey       *key,
+                                 QuartzCachePrimitive  primitive,
+                                 guint                 scale,
+                                 const HIRect         *rect)
+{
+  memset (key, 0, sizeof (QuartzCacheKey));
+
+  key->primitive = primitive;
+  key->width = (guint) ceil (rect->size.width);
+  key->height = (guint) ceil (rect->size.height);
+  key->scale = scale;
+}
+
+void
+quartz_cache_key_init (QuartzCacheKey       *key,
+                       QuartzCachePrimitive  primitive,
+                       GdkWindow            *window,
+                       const HIRect         *rect)
+{
+  quartz_cache_key_init_for_scale (key, primitive,
+                                   quartz_cache_get_scale (window), rect);
+}
+
+void
+quartz_cache_key_init_button (QuartzCacheKey              *key,
+                              guint                        scale,
+                              const HIThemeButtonDrawInfo *draw_info,
+                              const HIRect                *rect,
+                              guint                        frame)
+{
+  quartz_cache_key_init_for_scale (key, QUARTZ_CACHE_BUTTON, scale, rect);
+
+  key->kind = draw_info->kind;
+  key->state = draw_info->state;
+  key->value = draw_info->value;
+  key->adornment = draw_info->adornment;
+  key->frame = frame;
+}
+
+void
+quartz_cache_key_init_arrow (QuartzCacheKey                  *key,
+                             guint                            scale,
+                             const HIThemePopupArrowDrawInfo *draw_info,
+                             const HIRect                    *rect)
+{
+  quartz_cache_key_init_for_scale (key, QUARTZ_CACHE_ARROW, scale, rect);
+
+  key->kind = draw_info->orientation;
+  key->state = draw_info->state;
+  key->value = draw_info->size;
+}
+
+typedef struct
+{
+  QuartzCacheKey key;
+  CGImageRef     image;
+  guint          generation;
+} PendingImage;
+
+/* Images rendered by other threads. They are only moved into the cache
+ * from the main thread, so the cache itself needs no locking.
+ */
+static GAsyncQueue *pending = NULL;
+
+static void
+insert_pending (void)
+{
+  PendingImage *item;
+
+  if (!pending)
+    return;
+
+  while ((item = g_async_queue_try_pop (pending)))
+    {
+      /* Rendered with colors that changed since. */
+      if (item->generation == generation)
+        quartz_cache_insert (&item->key, item->image);
+      else
+        CGImageRelease (item->image);
+
+      g_free (item);
+    }
+}
+
+/* Must be called from the main thread before any other thread uses
+ * quartz_cache_insert_from_thread().
+ */
+void
+quartz_cache_init_threads (void)
+{
+  if (!pending)
+    pending = g_async_queue_new ();
+}
+
+/* Drops whatever the threads rendered that didn't make it into the
+ * cache. Only call this once no other thread uses the cache anymore.
+ */
+void
+quartz_cache_shutdown_threads (void)
+{
+  PendingImage *item;
+
+  if (!pending)
+    return;
+
+  while ((item = g_async_queue_try_pop (pending)))
+    {
+      CGImageRelease (item->image);
+      g_free (item);
+    }
+
+  g_async_queue_unref (pending);
+  pending = NULL;
+}
+
+/* Thread safe, takes ownership of image. The image shows up in the
+ * cache the next time the main thread looks something up.
+ */
+void
+quartz_cache_insert_from_thread (const QuartzCacheKey *key,
+                                 CGImageRef            image)
+{
+  PendingImage *item;
+
+  item = g_new (PendingImage, 1);
+  item->key = *key;
+  item->image = image;
+  item->generation = g_atomic_int_get (&generation);
+
+  g_async_queue_push (pending, item);
+}
+
+static CacheEntry *
+lookup_entry (const QuartzCacheKey *key)
+{
+  insert_pending ();
+
+  if (!cache)
+    return NULL;
+
+  return g_hash_table_lookup (cache, key);
+}
+
+/* Returns a new reference to the cached image, or NULL. Release it
+ * when done: a later insert may evict the entry at any time.
+ */
+CGImageRef
+quartz_cache_lookup (const QuartzCacheKey *key)
+{
+  CacheEntry *entry;
+
+  if (disabled)
+    return NULL;
+
+  entry = lookup_entry (key);
+  if (!entry)
+    return NULL;
+
+  if (entry->speculative)
+    {
+      stats.speculative_used++;
+      entry->speculative = FALSE;
+    }
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return CGImageRetain (entry->image);
+}
+
+/* Like quartz_cache_lookup() but without counting as a use. */
+gboolean
+quartz_cache_contains (const QuartzCacheKey *key)
+{
+  return lookup_entry (key) != NULL;
+}
+
+/* Renders into a new image without adding it to the cache. The caller
+ * owns the returned image.
+ */
+CGImageRef
+quartz_cache_render_image (const QuartzCacheKey  *key,
+                           QuartzCacheRenderFunc  func,
+                           gpointer               user_data)
+{
+  CGColorSpaceRef colorspace;
+  CGContextRef context;
+  CGImageRef image;
+  HIRect rect;
+  gint width, height;
+
+  if (disabled || key->width == 0 || key->height == 0)
+    return NULL;
+
+  width = (key->width + 2 * QUARTZ_CACHE_PADDING) * key->scale;
+  height = (key->height + 2 * QUARTZ_CACHE_PADDING) * key->scale;
+
+  colorspace = CGColorSpaceCreateDeviceRGB ();
+  context = CGBitmapContextCreate (NULL, width, height, 8, 0, colorspace,
+                                   kCGImageAlphaPremultipliedFirst |
+                                   kCGBitmapByteOrder32Host);
+  CGColorSpaceRelease (colorspace);
+
+  if (!context)
+    return NULL;
+
+  /* Use the same flipped coordinate system as the GDK contexts, so
+   * the render functions can be shared with the uncached paths.
+   */
+  CGContextTranslateCTM (context, 0, height);
+  CGContextScaleCTM (context, key->scale, -(gfloat) key->scale);
+
+  rect = CGRectMake (QUARTZ_CACHE_PADDING, QUARTZ_CACHE_PADDING,
+                     key->width, key->height);
+  func (context, &rect, user_data);
+
+  image = CGBitmapContextCreateImage (context);
+  CGContextRelease (context);
+
+  return image;
+}
+
+static void
+insert_entry (const QuartzCacheKey *key,
+              CGImageRef            image,
+              gboolean              speculative)
+{
+  CacheEntry *entry;
+  gsize bytes;
+
+  bytes = CGImageGetBytesPerRow (image) * CGImageGetHeight (image);
+  if (bytes > budget / MAX_ENTRY_SHARE)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  if (!cache)
+    cache = g_hash_table_new_full (quartz_cache_key_hash, quartz_cache_key_equal,
+                                   NULL, (GDestroyNotify) free_entry);
+
+  g_hash_table_remove (cache, key);
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->key = *key;
+  entry->image = image;
+  entry->bytes = bytes;
+  entry->speculative = speculative;
+  entry->link.data = entry;
+
+  evict (entry->bytes);
+
+  resident_bytes += entry->bytes;
+  g_queue_push_head_link (&lru, &entry->link);
+  g_hash_table_insert (cache, &entry->key, entry);
+
+  if (changed_func)
+    changed_func ();
+}
+
+/* Takes ownership of image. */
+void
+quartz_cache_insert (const QuartzCacheKey *key,
+                     CGImageRef            image)
+{
+  insert_entry (key, image, FALSE);
+}
+
+/* For images that were rendered because they will probably be needed
+ * soon. Whether they actually were is tracked in the statistics.
+ */
+void
+quartz_cache_insert_speculative (const QuartzCacheKey *key,
+                                 CGImageRef            image)
+{
+  stats.speculative++;
+  insert_entry (key, image, TRUE);
+}
+
+/* Renders and inserts the image. Like quartz_cache_lookup(), returns
+ * a reference for the caller.
+ */
+CGImageRef
+quartz_cache_render (const QuartzCacheKey  *key,
+                     QuartzCacheRenderFunc  func,
+                     gpointer               user_data)
+{
+  CGImageRef image;
+
+  image = quartz_cache_render_image (key, func, user_data);
+  if (image)
+    quartz_cache_insert (key, CGImageRetain (image));
+
+  return image;
+}
+
+/* When the image lands on whole device pixels at its own size there
+ * is nothing to filter, and turning interpolation off lets
+ * CoreGraphics composite it with a plain copy loop.
+ */
+static void
+set_interpolation (CGContextRef  context,
+                   CGImageRef    image,
+                   const HIRect *dest)
+{
+  CGRect device;
+
+  device = CGContextConvertRectToDeviceSpace (context, *dest);
+
+  if (fabs (fabs (device.size.width) - CGImageGetWidth (image)) < 0.01 &&
+      fabs (fabs (device.size.height) - CGImageGetHeight (image)) < 0.01 &&
+      fabs (device.origin.x - floor (device.origin.x + 0.5)) < 0.01 &&
+      fabs (device.origin.y - floor (device.origin.y + 0.5)) < 0.01)
+    CGContextSetInterpolationQuality (context, kCGInterpolationNone);
+}
+
+void
+quartz_cache_draw_image_in_rect (CGContextRef  context,
+                                 CGImageRef    image,
+                                 HIRect        dest)
+{
+  /* The destination is flipped, undo that for the image. */
+  CGContextSaveGState (context);
+  set_interpolation (context, image, &dest);
+  CGContextTranslateCTM (context, dest.origin.x, dest.origin.y + dest.size.height);
+  CGContextScaleCTM (context, 1.0f, -1.0f);
+  CGContextDrawImage (context, CGRectMake (0, 0, dest.size.width, dest.size.height), image);
+  CGContextRestoreGState (context);
+}
+
+void
+quartz_cache_draw_image (CGContextRef  context,
+                         CGImageRef    image,
+                         const HIRect *rect)
+{
+  quartz_cache_draw_image_in_rect (context, image,
+                                   CGRectInset (*rect, -QUARTZ_CACHE_PADDING, -QUARTZ_CACHE_PADDING));
+}
+
+/* Draws an image rendered at some template width stretched to the
+ * width of rect. The left and right cap (plus padding) are copied
+ * as is and only the middle part is scaled, which is fine for
+ * anything that has a purely vertical gradient.
+ */
+void
+quartz_cache_draw_image_three_part (CGContextRef  context,
+                                    CGImageRef    image,
+                                    const HIRect *rect,
+                                    guint         cap)
+{
+  CGImageRef part;
+  HIRect dest;
+  gfloat scale;
+  gfloat edge;
+  gsize width, height;
+
+  width = CGImageGetWidth (image);
+  height = CGImageGetHeight (image);
+  scale = (gfloat) height / (rect->size.height + 2 * QUARTZ_CACHE_PADDING);
+  edge = cap + QUARTZ_CACHE_PADDING;
+
+  dest = CGRectInset (*rect, -QUARTZ_CACHE_PADDING, -QUARTZ_CACHE_PADDING);
+
+  part = CGImageCreateWithImageInRect (image, CGRectMake (0, 0, edge * scale, height));
+  quartz_cache_draw_image_in_rect (context, part,
+                                   CGRectMake (dest.origin.x, dest.origin.y, edge, dest.size.height));
+  CGImageRelease (part);
+
+  part = CGImageCreateWithImageInRect (image, CGRectMake (edge * scale, 0, width - 2 * edge * scale, height));
+  quartz_cache_draw_image_in_rect (context, part,
+                                   CGRectMake (dest.origin.x + edge, dest.origin.y,
+                                               dest.size.width - 2 * edge, dest.size.height));
+  CGImageRelease (part);
+
+  part = CGImageCreateWithImageInRect (image, CGRectMake (width - edge * scale, 0, edge * scale, height));
+  quartz_cache_draw_image_in_rect (context, part,
+                                   CGRectMake (dest.origin.x + dest.size.width - edge, dest.origin.y,
+                                               edge, dest.size.height));
+  CGImageRelease (part);
+}
+
+void
+quartz_cache_clear (void)
+{
+  if (cache)
+    g_hash_table_remove_all (cache);
+}
+
+/* Sets the maximum number of bytes of image data kept around. Least
+ * recently used images are dropped to stay within it.
+ */
+void
+quartz_cache_set_budget (gsize bytes)
+{
+  budget = bytes;
+
+  if (cache)
+    evict (0);
+}
+
+/* Turns the cache off or back on, whatever QUARTZ_CACHE_DISABLE says.
+ * For comparing the cached paths with the direct ones.
+ */
+void
+quartz_cache_set_disabled (gboolean disable)
+{
+  disabled = disable;
+}
+
+/* Invalidates everything in the cache, for when something all images
+ * depend on changes, like the system colors. Stale images are dropped
+ * right away so they don't take up the budget, and images that threads
+ * are still rendering with the old colors are dropped when they arrive.
+ */
+void
+quartz_cache_new_generation (void)
+{
+  g_atomic_int_inc (&generation);
+  quartz_cache_clear ();
+}
+
+/* Counts what other threads finished rendering too. */
+gsize
+quartz_cache_get_resident_bytes (void)
+{
+  insert_pending ();
+
+  return resident_bytes;
+}
+
+guint
+quartz_cache_get_evictions (void)
+{
+  return stats.evictions;
+}
+
+/* Called whenever an image is added to the cache. */
+void
+quartz_cache_set_changed_func (QuartzCacheChangedFunc func)
+{
+  changed_func = func;
+}
+
+/* Calls func for every image, most recently used first. */
+void
+quartz_cache_foreach (QuartzCacheForeachFunc func,
+                      gpointer               user_data)
+{
+  CacheEntry *entry;
+  GList *l;
+
+  insert_pending ();
+
+  for (l = lru.head; l; l = l->next)
+    {
+      entry = l->data;
+      func (&entry->key, entry->image, user_data);
+    }
+}
+
+@interface QuartzCacheObserver : NSObject
+@end
+
+@implementation QuartzCacheObserver
+- (void) colorsChanged: (NSNotification *)notification
+{
+  quartz_cache_new_generation ();
+}
+@end
+
+void
+quartz_cache_init (void)
+{
+  static QuartzCacheObserver *observer = nil;
+  NSNotificationCenter *center;
+
+  if (observer)
+    return;
+
+  disabled = g_getenv ("QUARTZ_CACHE_DISABLE") != NULL;
+
+  observer = [[QuartzCacheObserver alloc] init];
+  center = [NSNotificationCenter defaultCenter];
+
+  [center addObserver: observer
+             selector: @selector(colorsChanged:)
+                 name: NSControlTintDidChangeNotification
+               object: nil];
+  [center addObserver: observer
+             selector: @selector(colorsChanged:)
+                 name: NSSystemColorsDidChangeNotification
+               object: nil];
+}
+
+/* Set QUARTZ_CACHE_STATS to get a summary at exit. */
+void
+quartz_cache_shutdown (void)
+{
+  if (g_getenv ("QUARTZ_CACHE_STATS"))
+    {
+      g_print ("quartz-engine cache: %u entries, %lu of %lu bytes, %u evictions\n",
+               cache ? g_hash_table_size (cache) : 0,
+               (gulong) resident_bytes, (gulong) budget, stats.evictions);
+      g_print ("quartz-engine cache: %u speculative renders, %u used, %u wasted\n",
+               stats.speculative, stats.speculative_used,
+               stats.speculative - stats.speculative_used);
+    }
+
+  if (cache)
+    {
+      g_hash_table_destroy (cache);
+      cache = NULL;
+    }
+}
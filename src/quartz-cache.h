@@ -0,0 +1,185 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_CACHE_H
+#define QUARTZ_CACHE_H
+
+/* Images are rendered with this much room around the requested rect,
+ * since HITheme likes to draw shadows and focus rings outside of it.
+ */
+#define QUARTZ_CACHE_PADDING 4
+
+/* Bump whenever an existing key starts rendering differently, so that
+ * images kept in the cache file by an older build are thrown away.
+ */
+#define QUARTZ_CACHE_RENDER_VERSION 1
+
+typedef enum {
+  QUARTZ_CACHE_BUTTON = 1,
+  QUARTZ_CACHE_TRACK,
+  QUARTZ_CACHE_THUMB,
+  QUARTZ_CACHE_GRADIENT,
+  QUARTZ_CACHE_PLACARD,
+  QUARTZ_CACHE_ARROW
+} QuartzCachePrimitive;
+
+/* Only plain guints so that keys can be hashed and compared as a
+ * whole. Always clear a key with quartz_cache_key_init() first.
+ */
+typedef struct
+{
+  guint primitive;
+  guint kind;
+  guint state;
+  guint value;
+  guint adornment;
+  guint width;
+  guint height;
+  guint scale;
+  guint frame;
+} QuartzCacheKey;
+
+typedef void (* QuartzCacheRenderFunc) (CGContextRef  context,
+                                        const HIRect *rect,
+                                        gpointer      user_data);
+
+typedef void (* QuartzCacheForeachFunc) (const QuartzCacheKey *key,
+                                         CGImageRef            image,
+                                         gpointer              user_data);
+
+typedef void (* QuartzCacheChangedFunc) (void);
+
+guint
+quartz_cache_get_scale (GdkWindow *window);
+
+void
+quartz_cache_key_init_for_scale (QuartzCacheKey       *key,
+                                 QuartzCachePrimitive  primitive,
+                                 guint                 scale,
+                                 const HIRect         *rect);
+
+void
+quartz_cache_key_init (QuartzCacheKey       *key,
+                       QuartzCachePrimitive  primitive,
+                       GdkWindow            *window,
+                       const HIRect         *rect);
+
+guint
+quartz_cache_key_hash (gconstpointer v);
+
+gboolean
+quartz_cache_key_equal (gconstpointer a,
+                        gconstpointer b);
+
+void
+quartz_cache_key_init_button (QuartzCacheKey              *key,
+                              guint                        scale,
+                              const HIThemeButtonDrawInfo *draw_info,
+                              const HIRect                *rect,
+                              guint                        frame);
+
+void
+quartz_cache_key_init_arrow (QuartzCacheKey                  *key,
+                             guint                            scale,
+                             const HIThemePopupArrowDrawInfo *draw_info,
+                             const HIRect                    *rect);
+
+CGImageRef
+quartz_cache_lookup (const QuartzCacheKey *key);
+
+CGImageRef
+quartz_cache_render_image (const QuartzCacheKey  *key,
+                           QuartzCacheRenderFunc  func,
+                           gpointer               user_data);
+
+void
+quartz_cache_insert (const QuartzCacheKey *key,
+                     CGImageRef            image);
+
+void
+quartz_cache_insert_speculative (const QuartzCacheKey *key,
+                                 CGImageRef            image);
+
+gboolean
+quartz_cache_contains (const QuartzCacheKey *key);
+
+void
+quartz_cache_init_threads (void);
+
+void
+quartz_cache_shutdown_threads (void);
+
+void
+quartz_cache_insert_from_thread (const QuartzCacheKey *key,
+                                 CGImageRef            image);
+
+CGImageRef
+quartz_cache_render (const QuartzCacheKey  *key,
+                     QuartzCacheRenderFunc  func,
+                     gpointer               user_data);
+
+void
+quartz_cache_draw_image_in_rect (CGContextRef  context,
+                                 CGImageRef    image,
+                                 HIRect        dest);
+
+void
+quartz_cache_draw_image (CGContextRef  context,
+                         CGImageRef    image,
+                         const HIRect *rect);
+
+void
+quartz_cache_draw_image_three_part (CGContextRef  context,
+                                    CGImageRef    image,
+                                    const HIRect *rect,
+                                    guint         cap);
+
+void
+quartz_cache_init (void);
+
+void
+quartz_cache_clear (void);
+
+void
+quartz_cache_set_budget (gsize bytes);
+
+void
+quartz_cache_set_disabled (gboolean disable);
+
+void
+quartz_cache_new_generation (void);
+
+gsize
+quartz_cache_get_resident_bytes (void);
+
+guint
+quartz_cache_get_evictions (void);
+
+void
+quartz_cache_set_changed_func (QuartzCacheChangedFunc func);
+
+void
+quartz_cache_foreach (QuartzCacheForeachFunc func,
+                      gpointer               user_data);
+
+void
+quartz_cache_shutdown (void);
+
+#endif /* QUARTZ_CACHE_H */
@@ -0,0 +1,317 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <config.h>
+#include <math.h>
+
+#include "quartz-cairo.h"
+
+/* Like DrawNativeGreyColorInRect(). */
+void
+quartz_cairo_draw_grey_line (cairo_t *cr,
+                             gdouble  grey,
+                             gdouble  x,
+                             gdouble  y,
+                             gdouble  width,
+                             gdouble  height)
+{
+  cairo_save (cr);
+  cairo_set_source_rgb (cr, grey, grey, grey);
+  cairo_rectangle (cr, x, y, width, height);
+  cairo_fill (cr);
+  cairo_restore (cr);
+}
+
+/* Fills the rect with a vertical gradient going from start at its top
+ * edge to end at its bottom edge, like quartz_draw_window_gradient().
+ */
+void
+quartz_cairo_draw_gradient (cairo_t *cr,
+                            gdouble  start,
+                            gdouble  end,
+                            gdouble  x,
+                            gdouble  y,
+                            gdouble  width,
+                            gdouble  height)
+{
+  cairo_pattern_t *pattern;
+
+  pattern = cairo_pattern_create_linear (0, y, 0, y + height);
+  cairo_pattern_add_color_stop_rgb (pattern, 0, start, start, start);
+  cairo_pattern_add_color_stop_rgb (pattern, 1, end, end, end);
+
+  cairo_save (cr);
+  cairo_set_source (cr, pattern);
+  cairo_rectangle (cr, x, y, width, height);
+  cairo_fill (cr);
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+}
+
+/* Same layout as quartz_draw_statusbar(): two half pixel border lines
+ * at the top and the gradient below them.
+ */
+void
+quartz_cairo_draw_statusbar (cairo_t                          *cr,
+                             const QuartzCairoStatusbarColors *colors,
+                             gdouble                           x,
+                             gdouble                           y,
+                             gdouble                           width,
+                             gdouble                           height)
+{
+  if (height > 2)
+    quartz_cairo_draw_gradient (cr, colors->gradient_start, colors->gradient_end,
+                                x, y + 2, width, height - 2);
+
+  quartz_cairo_draw_grey_line (cr, colors->first_border, x, y + 0.5, width, 0.5);
+  quartz_cairo_draw_grey_line (cr, colors->second_border, x, y + 1, width, 0.5);
+}
+
+static cairo_pattern_t *
+create_gradient (gdouble start,
+                 gdouble end,
+                 gdouble x0,
+                 gdouble y0,
+                 gdouble x1,
+                 gdouble y1)
+{
+  cairo_pattern_t *pattern;
+
+  pattern = cairo_pattern_create_linear (x0, y0, x1, y1);
+  cairo_pattern_add_color_stop_rgb (pattern, 0, start, start, start);
+  cairo_pattern_add_color_stop_rgb (pattern, 1, end, end, end);
+
+  return pattern;
+}
+
+/* A rect with rounded top corners, and bottom ones if round_bottom is
+ * set. With open_bottom, the bottom edge is left out, so that stroking
+ * it leaves the bottom without a border.
+ */
+static void
+rounded_rectangle (cairo_t  *cr,
+                   gdouble   radius,
+                   gboolean  round_bottom,
+                   gboolean  open_bottom,
+                   gdouble   x,
+                   gdouble   y,
+                   gdouble   width,
+                   gdouble   height)
+{
+  gdouble bottom_radius = round_bottom ? radius : 0;
+
+  radius = MIN (radius, MIN (width, height) / 2);
+  bottom_radius = MIN (bottom_radius, radius);
+
+  cairo_new_path (cr);
+  cairo_move_to (cr, x, y + height - bottom_radius);
+  cairo_line_to (cr, x, y + radius);
+  cairo_arc (cr, x + radius, y + radius, radius, G_PI, 3 * G_PI / 2);
+  cairo_line_to (cr, x + width - radius, y);
+  cairo_arc (cr, x + width - radius, y + radius, radius, 3 * G_PI / 2, 2 * G_PI);
+  cairo_line_to (cr, x + width, y + height - bottom_radius);
+
+  if (open_bottom)
+    return;
+
+  cairo_arc (cr, x + width - bottom_radius, y + height - bottom_radius, bottom_radius,
+             0, G_PI / 2);
+  cairo_line_to (cr, x + bottom_radius, y + height);
+  cairo_arc (cr, x + bottom_radius, y + height - bottom_radius, bottom_radius,
+             G_PI / 2, G_PI);
+  cairo_close_path (cr);
+}
+
+/* The border is stroked on the outermost pixels, and the gradient
+ * fills what is inside of it.
+ */
+static void
+draw_bordered (cairo_t                      *cr,
+               const QuartzCairoBezelColors *colors,
+               gdouble                       radius,
+               gboolean                      round_bottom,
+               gboolean                      open_bottom,
+               gdouble                       x,
+               gdouble                       y,
+               gdouble                       width,
+               gdouble                       height)
+{
+  cairo_pattern_t *pattern;
+
+  if (width < 1 || height < 1)
+    return;
+
+  pattern = create_gradient (colors->fill_start, colors->fill_end, 0, y, 0, y + height);
+
+  cairo_save (cr);
+
+  rounded_rectangle (cr, radius, round_bottom, FALSE, x, y, width, height);
+  cairo_set_source (cr, pattern);
+  cairo_fill (cr);
+
+  rounded_rectangle (cr, radius, round_bottom, open_bottom,
+                     x + 0.5, y + 0.5, width - 1, open_bottom ? height - 0.5 : height - 1);
+  cairo_set_source_rgb (cr, colors->border, colors->border, colors->border);
+  cairo_set_line_width (cr, 1);
+  cairo_stroke (cr);
+
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+}
+
+/* Push buttons and text field bezels. */
+void
+quartz_cairo_draw_bezel (cairo_t                      *cr,
+                         const QuartzCairoBezelColors *colors,
+                         gdouble                       radius,
+                         gdouble                       x,
+                         gdouble                       y,
+                         gdouble                       width,
+                         gdouble                       height)
+{
+  draw_bordered (cr, colors, radius, TRUE, FALSE, x, y, width, height);
+}
+
+/* Like kThemePlacard, a bezel with square corners. */
+void
+quartz_cairo_draw_placard (cairo_t                      *cr,
+                           const QuartzCairoBezelColors *colors,
+                           gdouble                       x,
+                           gdouble                       y,
+                           gdouble                       width,
+                           gdouble                       height)
+{
+  draw_bordered (cr, colors, 0, FALSE, FALSE, x, y, width, height);
+}
+
+/* A notebook tab: rounded at the top, and open at the bottom where it
+ * joins the page.
+ */
+void
+quartz_cairo_draw_tab (cairo_t                      *cr,
+                       const QuartzCairoBezelColors *colors,
+                       gdouble                       radius,
+                       gdouble                       x,
+                       gdouble                       y,
+                       gdouble                       width,
+                       gdouble                       height)
+{
+  draw_bordered (cr, colors, radius, FALSE, TRUE, x, y, width, height);
+}
+
+/* A scrollbar: a trough with rounded ends, and the thumb inset by two
+ * pixels at thumb_offset along it, shaded across its thickness.
+ */
+void
+quartz_cairo_draw_track (cairo_t                      *cr,
+                         const QuartzCairoTrackColors *colors,
+                         gboolean                      horizontal,
+                         gdouble                       thumb_offset,
+                         gdouble                       thumb_length,
+                         gdouble                       x,
+                         gdouble                       y,
+                         gdouble                       width,
+                         gdouble                       height)
+{
+  QuartzCairoBezelColors trough = { colors->border, colors->trough, colors->trough };
+  cairo_pattern_t *pattern;
+  gdouble thickness;
+
+  if (width < 5 || height < 5)
+    return;
+
+  thickness = horizontal ? height : width;
+
+  draw_bordered (cr, &trough, thickness / 2, TRUE, FALSE, x, y, width, height);
+
+  if (thumb_length <= 0)
+    return;
+
+  if (horizontal)
+    {
+      pattern = create_gradient (colors->thumb_start, colors->thumb_end, 0, y, 0, y + height);
+      rounded_rectangle (cr, (height - 4) / 2, TRUE, FALSE,
+                         x + 2 + thumb_offset, y + 2, thumb_length, height - 4);
+    }
+  else
+    {
+      pattern = create_gradient (colors->thumb_start, colors->thumb_end, x, 0, x + width, 0);
+      rounded_rectangle (cr, (width - 4) / 2, TRUE, FALSE,
+                         x + 2, y + 2 + thumb_offset, width - 4, thumb_length);
+    }
+
+  cairo_save (cr);
+  cairo_set_source (cr, pattern);
+  cairo_fill (cr);
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+}
+
+/* A GTK_SHADOW_IN frame, one pixel wide. The inside is left alone. */
+void
+quartz_cairo_draw_frame (cairo_t                      *cr,
+                         const QuartzCairoFrameColors *colors,
+                         gdouble                       x,
+                         gdouble                       y,
+                         gdouble                       width,
+                         gdouble                       height)
+{
+  if (width < 2 || height < 2)
+    return;
+
+  quartz_cairo_draw_grey_line (cr, colors->sides, x, y + 1, 1, height - 2);
+  quartz_cairo_draw_grey_line (cr, colors->sides, x + width - 1, y + 1, 1, height - 2);
+  quartz_cairo_draw_grey_line (cr, colors->top, x, y, width, 1);
+  quartz_cairo_draw_grey_line (cr, colors->bottom, x, y + height - 1, width, 1);
+}
+
+#define MENU_RADIUS 4
+
+/* Menus are a flat, slightly translucent grey with rounded corners at
+ * the bottom.
+ */
+void
+quartz_cairo_draw_menu (cairo_t *cr,
+                        gdouble  grey,
+                        gdouble  alpha,
+                        gdouble  x,
+                        gdouble  y,
+                        gdouble  width,
+                        gdouble  height)
+{
+  gdouble radius = MIN (MENU_RADIUS, MIN (width, height) / 2);
+
+  cairo_save (cr);
+
+  cairo_new_path (cr);
+  cairo_move_to (cr, x, y);
+  cairo_line_to (cr, x + width, y);
+  cairo_arc (cr, x + width - radius, y + height - radius, radius, 0, G_PI / 2);
+  cairo_arc (cr, x + radius, y + height - radius, radius, G_PI / 2, G_PI);
+  cairo_close_path (cr);
+
+  cairo_set_source_rgba (cr, grey, grey, grey, alpha);
+  cairo_fill (cr);
+
+  cairo_restore (cr);
+}
@@ -0,0 +1,138 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_CAIRO_H
+#define QUARTZ_CAIRO_H
+
+#include <glib.h>
+#include <cairo.h>
+
+/* Approximations of the native primitives, drawn with cairo. They
+ * don't depend on Carbon, so fill rate can be measured on any
+ * platform with real pixels. The engine itself draws through HITheme.
+ *
+ * Greys go from 0 to 1, see nsNativeThemeColors.h for the native ones.
+ */
+
+typedef struct
+{
+  gdouble first_border;
+  gdouble second_border;
+  gdouble gradient_start;
+  gdouble gradient_end;
+} QuartzCairoStatusbarColors;
+
+/* Bezels, placards and tabs: a one pixel border around a vertical
+ * gradient.
+ */
+typedef struct
+{
+  gdouble border;
+  gdouble fill_start;
+  gdouble fill_end;
+} QuartzCairoBezelColors;
+
+typedef struct
+{
+  gdouble border;
+  gdouble trough;
+  gdouble thumb_start;
+  gdouble thumb_end;
+} QuartzCairoTrackColors;
+
+/* A sunken frame is darker at the top than at the bottom. */
+typedef struct
+{
+  gdouble top;
+  gdouble sides;
+  gdouble bottom;
+} QuartzCairoFrameColors;
+
+void quartz_cairo_draw_grey_line (cairo_t                          *cr,
+                                  gdouble                           grey,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_gradient  (cairo_t                          *cr,
+                                  gdouble                           start,
+                                  gdouble                           end,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_statusbar (cairo_t                          *cr,
+                                  const QuartzCairoStatusbarColors *colors,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_bezel     (cairo_t                          *cr,
+                                  const QuartzCairoBezelColors     *colors,
+                                  gdouble                           radius,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_placard   (cairo_t                          *cr,
+                                  const QuartzCairoBezelColors     *colors,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_tab       (cairo_t                          *cr,
+                                  const QuartzCairoBezelColors     *colors,
+                                  gdouble                           radius,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_track     (cairo_t                          *cr,
+                                  const QuartzCairoTrackColors     *colors,
+                                  gboolean                          horizontal,
+                                  gdouble                           thumb_offset,
+                                  gdouble                           thumb_length,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_frame     (cairo_t                          *cr,
+                                  const QuartzCairoFrameColors     *colors,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+void quartz_cairo_draw_menu      (cairo_t                          *cr,
+                                  gdouble                           grey,
+                                  gdouble                           alpha,
+                                  gdouble                           x,
+                                  gdouble                           y,
+                                  gdouble                           width,
+                                  gdouble                           height);
+
+#endif /* QUARTZ_CAIRO_H */
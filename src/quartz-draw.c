@@ -20,9 +20,19 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <gtk/gtk.h>
 #include <Carbon/Carbon.h>
 
+#include "quartz-style.h"
+#include "quartz-cache.h"
+#include "quartz-metrics.h"
+#include "quartz-geometry.h"
+#include "quartz-animation.h"
+#include "quartz-prerender.h"
+#include "quartz-main-state.h"
+#include "quartz-stats.h"
+#include "quartz-expose.h"
 #include "WindowGradientHelper.h"
 
 #define IS_DETAIL(d,x) (d && strcmp (d, x) == 0)
@@ -80,44 +90,714 @@ release_context (GdkWindow    *window,
 	gdk_quartz_drawable_release_context (drawable, context);
 }
 
-#if 0
+void
+quartz_render_button (CGContextRef  context,
+                      const HIRect *rect,
+                      gpointer      user_data)
+{
+  HIThemeDrawButton (rect,
+                     user_data,
+                     context,
+                     kHIThemeOrientationNormal,
+                     NULL);
+}
+
+static void
+draw_cached_button_frame (GdkWindow             *window,
+                          GdkRectangle          *area,
+                          HIThemeButtonDrawInfo *draw_info,
+                          const HIRect          *rect,
+                          guint                  frame)
+{
+  CGContextRef context;
+  CGImageRef image;
+  QuartzCacheKey key;
+
+  quartz_cache_key_init_button (&key, quartz_cache_get_scale (window),
+                                draw_info, rect, frame);
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, quartz_render_button, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  if (image)
+    quartz_cache_draw_image (context, image, rect);
+  else
+    quartz_render_button (context, rect, draw_info);
+
+  release_context (window, context);
+  CGImageRelease (image);
+
+  if (frame == 0)
+    quartz_prerender_predict_button (key.scale, draw_info, rect);
+}
+
+/* Draws a button through the render cache. Meant for controls that are
+ * drawn many times with identical parameters, like the checkboxes of a
+ * toggle column, where each draw then becomes a plain image blit.
+ */
+void
+quartz_draw_cached_button (GdkWindow             *window,
+                           GdkRectangle          *area,
+                           HIThemeButtonDrawInfo *draw_info,
+                           const HIRect          *rect)
+{
+  draw_cached_button_frame (window, area, draw_info, rect, 0);
+
+  if (draw_info->state == kThemeStatePressed)
+    quartz_stats_add_pressed_draw ();
+}
+
+
+void
+quartz_render_popup_arrow (CGContextRef  context,
+                           const HIRect *rect,
+                           gpointer      user_data)
+{
+  HIThemeDrawPopupArrow (rect, user_data, context, kHIThemeOrientationNormal);
+}
+
+/* Arrows come in few sizes and states, but there are a lot of them in
+ * toolbars and menus, so they go through the render cache too.
+ */
+void
+quartz_draw_popup_arrow (GdkWindow                       *window,
+                         GdkRectangle                    *area,
+                         const HIThemePopupArrowDrawInfo *draw_info,
+                         const HIRect                    *rect)
+{
+  CGContextRef context;
+  CGImageRef image;
+  QuartzCacheKey key;
+
+  quartz_cache_key_init_arrow (&key, quartz_cache_get_scale (window), draw_info, rect);
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, quartz_render_popup_arrow, (gpointer) draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  if (image)
+    quartz_cache_draw_image (context, image, rect);
+  else
+    quartz_render_popup_arrow (context, rect, (gpointer) draw_info);
+
+  release_context (window, context);
+  CGImageRelease (image);
+}
+
+
+/* List headers are rendered once per state and height at a template
+ * width and then stretched to each column, so wide treeviews don't
+ * call into HITheme for every column on every expose.
+ */
+#define LIST_HEADER_CAP 8
+
+void
+quartz_draw_list_header (GdkWindow             *window,
+                         GdkRectangle          *area,
+                         HIThemeButtonDrawInfo *draw_info,
+                         const HIRect          *rect)
+{
+  CGContextRef context;
+  CGImageRef image;
+  QuartzCacheKey key;
+  HIRect template;
+
+  if (rect->size.width < 2 * LIST_HEADER_CAP)
+    {
+      quartz_draw_cached_button (window, area, draw_info, rect);
+      return;
+    }
+
+  template = CGRectMake (0, 0, QUARTZ_LIST_HEADER_TEMPLATE_WIDTH, rect->size.height);
+
+  quartz_cache_key_init_button (&key, quartz_cache_get_scale (window),
+                                draw_info, &template, 0);
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, quartz_render_button, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  if (image)
+    quartz_cache_draw_image_three_part (context, image, rect, LIST_HEADER_CAP);
+  else
+    quartz_render_button (context, rect, draw_info);
+
+  release_context (window, context);
+  CGImageRelease (image);
+
+  /* The pressed template, for when the column is clicked. */
+  quartz_prerender_predict_button (key.scale, draw_info, &template);
+}
+
+
 static void
-quartz_measure_button (HIThemeButtonDrawInfo *draw_info,
-                       gint                   width,
-                       gint                   height)
+render_track (CGContextRef  context,
+              const HIRect *rect,
+              gpointer      user_data)
+{
+  HIThemeTrackDrawInfo draw_info = *(HIThemeTrackDrawInfo *) user_data;
+
+  draw_info.bounds = *rect;
+  HIThemeDrawTrack (&draw_info, NULL, context, kHIThemeOrientationNormal);
+}
+
+static CGImageRef
+get_track_background (GdkWindow                  *window,
+                      const HIThemeTrackDrawInfo *draw_info)
 {
-  HIRect in_rect, out_rect;
+  HIThemeTrackDrawInfo track_info;
+  QuartzCacheKey key;
+  CGImageRef image;
+
+  track_info = *draw_info;
+  track_info.attributes &= ~kThemeTrackShowThumb;
+  track_info.value = track_info.min;
+
+  quartz_cache_key_init (&key, QUARTZ_CACHE_TRACK, window, &draw_info->bounds);
+  key.kind = track_info.kind;
+  key.state = track_info.enableState;
+  key.adornment = track_info.attributes;
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, render_track, &track_info);
+
+  return image;
+}
+
+static gboolean
+get_thumb_bounds (const HIThemeTrackDrawInfo *draw_info,
+                  SInt32                      value,
+                  HIRect                     *bounds)
+{
+  HIThemeTrackDrawInfo thumb_info;
   HIShapeRef shape;
 
-  in_rect.origin.x = 0;
-  in_rect.origin.y = 0;
-  in_rect.size.width = width;
-  in_rect.size.height = height;
-
-  HIThemeGetButtonShape (&in_rect, draw_info, &shape);
-  HIShapeGetBounds (shape, &out_rect);
-  NSLog (@"Shape: %d %d, %d %d  ",
-           (int) out_rect.origin.x,
-           (int) out_rect.origin.y,
-           (int) out_rect.size.width - (int) out_rect.origin.x,
-           (int) out_rect.size.height - (int) out_rect.origin.y);
-
-  HIThemeGetButtonBackgroundBounds (&in_rect, draw_info, &out_rect);
-  NSLog (@"Bounds: %d %d, %d %d  ",
-           (int) out_rect.origin.x,
-           (int) out_rect.origin.y,
-           (int) out_rect.size.width - (int) out_rect.origin.x,
-           (int) out_rect.size.height - (int) out_rect.origin.y);
-
-  HIThemeGetButtonContentBounds (&in_rect, draw_info, &out_rect);
-  NSLog (@"Content: %d %d, %d %d\n",
-           (int) out_rect.origin.x,
-           (int) out_rect.origin.y,
-           (int) out_rect.size.width - (int) out_rect.origin.x,
-           (int) out_rect.size.height - (int) out_rect.origin.y);
+  thumb_info = *draw_info;
+  thumb_info.value = value;
+
+  if (HIThemeGetTrackThumbShape (&thumb_info, &shape) != noErr)
+    return FALSE;
+
+  HIShapeGetBounds (shape, bounds);
+  CFRelease (shape);
+
+  return TRUE;
+}
+
+/* Draws a scrollbar track. The track itself doesn't change when
+ * scrolling, so it comes from the render cache and only the thumb is
+ * drawn through HITheme, clipped to its own bounds.
+ *
+ * Invalidating just the old and the new thumb isn't possible from
+ * here: GtkRange queues a redraw of its whole allocation on every
+ * value change, and the double buffered expose clears all of it to the
+ * parent's background first, so the whole track has to be painted
+ * again anyway. Blitting it from the cache keeps that cheap.
+ */
+void
+quartz_draw_track (GdkWindow            *window,
+                   GdkRectangle         *area,
+                   HIThemeTrackDrawInfo *draw_info)
+{
+  CGContextRef context;
+  CGImageRef image;
+  HIRect thumb;
+
+  image = get_track_background (window, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  if (!image)
+    {
+      HIThemeDrawTrack (draw_info, NULL, context, kHIThemeOrientationNormal);
+      release_context (window, context);
+      return;
+    }
+
+  quartz_cache_draw_image (context, image, &draw_info->bounds);
+  CGImageRelease (image);
+
+  if ((draw_info->attributes & kThemeTrackShowThumb) &&
+      get_thumb_bounds (draw_info, draw_info->value, &thumb))
+    {
+      CGContextClipToRect (context, thumb);
+      HIThemeDrawTrack (draw_info, NULL, context, kHIThemeOrientationNormal);
+    }
+
+  release_context (window, context);
+}
+
+/* Room around the slider knob that is copied along with it, so its
+ * shadow isn't cut off. Whatever track is under it is the same all
+ * along the track, except for the end caps, which quartz_draw_slider
+ * clips it off of.
+ */
+#define SLIDER_THUMB_PADDING 2
+
+static CGImageRef
+get_slider_thumb (GdkWindow                  *window,
+                  const HIThemeTrackDrawInfo *draw_info)
+{
+  HIThemeTrackDrawInfo thumb_info;
+  QuartzCacheKey key;
+  CGImageRef source, image;
+  HIRect thumb, crop;
+
+  quartz_cache_key_init (&key, QUARTZ_CACHE_THUMB, window, &draw_info->bounds);
+  key.kind = draw_info->kind;
+  key.state = draw_info->enableState;
+  key.adornment = draw_info->attributes;
+
+  image = quartz_cache_lookup (&key);
+  if (image)
+    return image;
+
+  /* Render the knob in the middle of the track, away from the end
+   * caps, and cut it out.
+   */
+  thumb_info = *draw_info;
+  thumb_info.value = draw_info->min + (draw_info->max - draw_info->min) / 2;
+
+  if (!get_thumb_bounds (&thumb_info, thumb_info.value, &thumb))
+    return NULL;
+
+  source = quartz_cache_render_image (&key, render_track, &thumb_info);
+  if (!source)
+    return NULL;
+
+  crop = CGRectInset (thumb, -SLIDER_THUMB_PADDING, -SLIDER_THUMB_PADDING);
+  crop = CGRectOffset (crop,
+                       QUARTZ_CACHE_PADDING - draw_info->bounds.origin.x,
+                       QUARTZ_CACHE_PADDING - draw_info->bounds.origin.y);
+  crop = CGRectMake (crop.origin.x * key.scale, crop.origin.y * key.scale,
+                     crop.size.width * key.scale, crop.size.height * key.scale);
+
+  image = CGImageCreateWithImageInRect (source, crop);
+  CGImageRelease (source);
+
+  if (image)
+    quartz_cache_insert (&key, CGImageRetain (image));
+
+  return image;
+}
+
+/* Draws a slider as a cached track with a cached knob composited on
+ * top of it, at the position the adjustment value maps to.
+ */
+void
+quartz_draw_slider (GdkWindow            *window,
+                    GdkRectangle         *area,
+                    HIThemeTrackDrawInfo *draw_info)
+{
+  CGContextRef context;
+  CGImageRef background, thumb_image;
+  HIRect first, last, dest;
+  QuartzRect first_rect, last_rect, drag_rect, thumb_rect;
+  gboolean horizontal;
+
+  /* Both images are our own references, so inserting the thumb can't
+   * evict the background from under us.
+   */
+  background = get_track_background (window, draw_info);
+  thumb_image = get_slider_thumb (window, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    goto out;
+
+  if (!background || !thumb_image ||
+      !get_thumb_bounds (draw_info, draw_info->min, &first) ||
+      !get_thumb_bounds (draw_info, draw_info->max, &last))
+    {
+      HIThemeDrawTrack (draw_info, NULL, context, kHIThemeOrientationNormal);
+      release_context (window, context);
+      goto out;
+    }
+
+  horizontal = (draw_info->attributes & kThemeTrackHorizontal) != 0;
+
+  first_rect.x = first.origin.x;
+  first_rect.y = first.origin.y;
+  first_rect.width = first.size.width;
+  first_rect.height = first.size.height;
+
+  last_rect.x = last.origin.x;
+  last_rect.y = last.origin.y;
+  last_rect.width = last.size.width;
+  last_rect.height = last.size.height;
+
+  /* The knob travels between where it is at min and at max. */
+  quartz_rect_union (&first_rect, &last_rect, &drag_rect);
+  quartz_track_thumb_rect (&drag_rect, horizontal,
+                           draw_info->min, draw_info->max, 0,
+                           draw_info->value,
+                           horizontal ? first_rect.width : first_rect.height,
+                           &thumb_rect);
+
+  /* Keep the knob on whole pixels so the blit isn't resampled. */
+  dest = CGRectMake (floor (thumb_rect.x + 0.5), floor (thumb_rect.y + 0.5),
+                     first.size.width, first.size.height);
+  dest = CGRectInset (dest, -SLIDER_THUMB_PADDING, -SLIDER_THUMB_PADDING);
+
+  quartz_cache_draw_image (context, background, &draw_info->bounds);
+
+  /* The padding around the knob comes from the middle of the track.
+   * Don't let it reach past the knob's end positions, over the end
+   * caps.
+   */
+  if (horizontal)
+    CGContextClipToRect (context, CGRectMake (drag_rect.x, dest.origin.y,
+                                              drag_rect.width, dest.size.height));
+  else
+    CGContextClipToRect (context, CGRectMake (dest.origin.x, drag_rect.y,
+                                              dest.size.width, drag_rect.height));
+
+  quartz_cache_draw_image_in_rect (context, thumb_image, dest);
+
+  release_context (window, context);
+
+ out:
+  CGImageRelease (background);
+  CGImageRelease (thumb_image);
+}
+
+/* While the user drags a window edge, chrome that spans the whole
+ * window is drawn from cached strips instead of being rendered again
+ * for every intermediate size. The window is repainted exactly once
+ * the resize ends.
+ */
+static GHashTable *live_resize_windows = NULL;
+static gboolean live_resize_forced = FALSE;
+
+@interface QuartzLiveResizeObserver : NSObject
+@end
+
+@implementation QuartzLiveResizeObserver
+- (void) endLiveResize: (NSNotification *)notification
+{
+  NSWindow *wnd = [notification object];
+
+  if (g_hash_table_remove (live_resize_windows, wnd))
+    [[wnd contentView] setNeedsDisplay: YES];
+}
+@end
+
+gboolean
+quartz_window_in_live_resize (GdkWindow *window)
+{
+  static QuartzLiveResizeObserver *observer = nil;
+  NSWindow *wnd;
+
+  if (!window || GDK_IS_PIXMAP (window))
+    return FALSE;
+
+  if (live_resize_forced)
+    return TRUE;
+
+  wnd = gdk_quartz_window_get_nswindow (window);
+  if (!wnd || ![wnd inLiveResize])
+    return FALSE;
+
+  if (!observer)
+    {
+      live_resize_windows = g_hash_table_new (NULL, NULL);
+
+      observer = [[QuartzLiveResizeObserver alloc] init];
+      [[NSNotificationCenter defaultCenter] addObserver: observer
+                                               selector: @selector(endLiveResize:)
+                                                   name: NSWindowDidEndLiveResizeNotification
+                                                 object: nil];
+    }
+
+  g_hash_table_insert (live_resize_windows, wnd, wnd);
+
+  return TRUE;
+}
+
+/* Makes every window draw as if it was being resized, for the tests,
+ * which can't get AppKit to start a live resize. No repaint follows
+ * when it is turned off again.
+ */
+void
+quartz_draw_set_live_resize_forced (gboolean forced)
+{
+  live_resize_forced = forced;
+}
+
+/* Draws a vertical gradient filling rect, starting at its top edge.
+ * The context must not be flipped.
+ */
+void
+quartz_draw_window_gradient (GdkWindow     *window,
+                             CGContextRef   context,
+                             CGGradientRef  gradient,
+                             CGRect         rect)
+{
+  CGImageRef strip = NULL;
+
+  if (quartz_window_in_live_resize (window))
+    strip = [WindowGradientHelper stripForGradient: gradient
+                                            height: rect.size.height
+                                             scale: quartz_cache_get_scale (window)];
+
+  if (strip)
+    {
+      CGContextSaveGState (context);
+      CGContextSetInterpolationQuality (context, kCGInterpolationNone);
+      CGContextDrawImage (context, rect, strip);
+      CGContextRestoreGState (context);
+      CGImageRelease (strip);
+    }
+  else
+    CGContextDrawLinearGradient (context, gradient,
+                                 CGPointMake (0.0f, CGRectGetMaxY (rect)),
+                                 CGPointMake (0.0f, CGRectGetMinY (rect)), 0);
+}
+
+/* The placard is rendered once at this size and its flat middle part
+ * is stretched over the window during a live resize.
+ */
+#define PLACARD_TEMPLATE_SIZE 32
+#define PLACARD_TEMPLATE_INSET 8
+
+static void
+render_placard (CGContextRef  context,
+                const HIRect *rect,
+                gpointer      user_data)
+{
+  HIThemeDrawPlacard (rect, user_data, context, kHIThemeOrientationNormal);
+}
+
+static CGImageRef
+get_placard_fill (GdkWindow                    *window,
+                  const HIThemePlacardDrawInfo *draw_info)
+{
+  QuartzCacheKey key;
+  CGImageRef source, image;
+  HIRect template;
+  gfloat inset;
+
+  template = CGRectMake (0, 0, PLACARD_TEMPLATE_SIZE, PLACARD_TEMPLATE_SIZE);
+
+  quartz_cache_key_init (&key, QUARTZ_CACHE_PLACARD, window, &template);
+  key.state = draw_info->state;
+
+  image = quartz_cache_lookup (&key);
+  if (image)
+    return image;
+
+  source = quartz_cache_render_image (&key, render_placard, (gpointer) draw_info);
+  if (!source)
+    return NULL;
+
+  inset = (QUARTZ_CACHE_PADDING + PLACARD_TEMPLATE_INSET) * key.scale;
+  image = CGImageCreateWithImageInRect (source,
+                                        CGRectMake (inset, inset,
+                                                    CGImageGetWidth (source) - 2 * inset,
+                                                    CGImageGetHeight (source) - 2 * inset));
+  CGImageRelease (source);
+
+  if (image)
+    quartz_cache_insert (&key, CGImageRetain (image));
+
+  return image;
+}
+
+/* For placards that cover a whole window, with their border outside
+ * of it.
+ */
+void
+quartz_draw_window_placard (GdkWindow                    *window,
+                            GdkRectangle                 *area,
+                            const HIThemePlacardDrawInfo *draw_info,
+                            const HIRect                 *rect)
+{
+  CGContextRef context;
+  CGImageRef fill = NULL;
+
+  if (quartz_expose_merge_fill (window, area,
+                                floor (rect->origin.x), floor (rect->origin.y),
+                                ceil (rect->size.width), ceil (rect->size.height)))
+    return;
+
+  if (quartz_window_in_live_resize (window))
+    fill = get_placard_fill (window, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (fill);
+      return;
+    }
+
+  if (fill)
+    {
+      CGContextSetInterpolationQuality (context, kCGInterpolationNone);
+      quartz_cache_draw_image_in_rect (context, fill, *rect);
+      CGImageRelease (fill);
+    }
+  else
+    HIThemeDrawPlacard (rect, draw_info, context, kHIThemeOrientationNormal);
+
+  release_context (window, context);
+}
+
+/* The default button pulse is emulated with a fixed number of frames
+ * per period, each rendered once with the matching animation time and
+ * then cycled through by the engine's frame clock.
+ */
+#define DEFAULT_BUTTON_PULSE_FRAMES 16
+#define DEFAULT_BUTTON_PULSE_PERIOD 1.6
+
+/* The frame of the pulse last drawn for a button, plus one. */
+static GQuark pulse_frame_quark = 0;
+
+/* Follows the wall clock, so the pulse keeps its speed whatever rate
+ * the frame clock runs at.
+ */
+static guint
+get_default_button_frame (void)
+{
+  gint64 frame_time = DEFAULT_BUTTON_PULSE_PERIOD * G_USEC_PER_SEC / DEFAULT_BUTTON_PULSE_FRAMES;
+
+  return (g_get_monotonic_time () / frame_time) % DEFAULT_BUTTON_PULSE_FRAMES;
+}
+
+static QuartzAnimationState
+default_button_animation_state (GtkWidget *widget)
+{
+  NSWindow *wnd;
+  guint drawn;
+
+  if (!GTK_WIDGET_HAS_DEFAULT (widget) || !GTK_WIDGET_IS_SENSITIVE (widget))
+    return QUARTZ_ANIMATION_STOP;
+
+  /* Only the main window pulses, don't burn CPU on background dialogs. */
+  wnd = gdk_quartz_window_get_nswindow (widget->window);
+  if (!wnd || ![wnd isMainWindow])
+    return QUARTZ_ANIMATION_PAUSE;
+
+  drawn = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (widget), pulse_frame_quark));
+  if (drawn == get_default_button_frame () + 1)
+    return QUARTZ_ANIMATION_SKIP;
+
+  return QUARTZ_ANIMATION_RUN;
 }
-#endif
 
+static void
+draw_default_button (GdkWindow             *window,
+                     GtkWidget             *widget,
+                     HIThemeButtonDrawInfo *draw_info,
+                     const HIRect          *rect)
+{
+  QuartzAnimationState state;
+  GdkRectangle invalid;
+  guint frame = 0;
+
+  if (!pulse_frame_quark)
+    pulse_frame_quark = g_quark_from_static_string ("quartz-pulse-frame");
+
+  draw_info->adornment |= kThemeAdornmentDefault;
+
+  state = default_button_animation_state (widget);
+  if (state == QUARTZ_ANIMATION_RUN || state == QUARTZ_ANIMATION_SKIP)
+    frame = get_default_button_frame ();
+
+  g_object_set_qdata (G_OBJECT (widget), pulse_frame_quark, GUINT_TO_POINTER (frame + 1));
+
+  draw_info->animation.time.start = 0;
+  draw_info->animation.time.current =
+    frame * DEFAULT_BUTTON_PULSE_PERIOD / DEFAULT_BUTTON_PULSE_FRAMES;
+
+  draw_cached_button_frame (window, NULL, draw_info, rect, frame);
+
+  quartz_metrics_button_extent (draw_info, rect, &invalid);
+
+  quartz_animation_add (widget, window, &invalid, default_button_animation_state);
+}
+
+
+/* Renders the button at the size of bbox and scales the result into
+ * rect.
+ */
+static void
+draw_stretched_button (GdkWindow             *window,
+                       GdkRectangle          *area,
+                       HIThemeButtonDrawInfo *draw_info,
+                       const HIRect          *bbox,
+                       const HIRect          *rect)
+{
+  CGContextRef context;
+  CGImageRef image;
+  QuartzCacheKey key;
+  gfloat sx, sy;
+
+  if (bbox->size.width <= 0 || bbox->size.height <= 0)
+    return;
+
+  quartz_cache_key_init_button (&key, quartz_cache_get_scale (window),
+                                draw_info, bbox, 0);
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, quartz_render_button, draw_info);
+
+  context = get_context (window, area);
+  if (!context)
+    {
+      CGImageRelease (image);
+      return;
+    }
+
+  sx = rect->size.width / bbox->size.width;
+  sy = rect->size.height / bbox->size.height;
+
+  if (image)
+    quartz_cache_draw_image_in_rect (context, image,
+                                     CGRectMake (rect->origin.x - QUARTZ_CACHE_PADDING * sx,
+                                                 rect->origin.y - QUARTZ_CACHE_PADDING * sy,
+                                                 rect->size.width + 2 * QUARTZ_CACHE_PADDING * sx,
+                                                 rect->size.height + 2 * QUARTZ_CACHE_PADDING * sy));
+  else
+    {
+      CGContextTranslateCTM (context, rect->origin.x, rect->origin.y);
+      CGContextScaleCTM (context, sx, sy);
+      quartz_render_button (context, bbox, draw_info);
+    }
+
+  release_context (window, context);
+  CGImageRelease (image);
+
+  quartz_prerender_predict_button (key.scale, draw_info, bbox);
+}
 
 void
 quartz_draw_button (GtkStyle        *style,
@@ -133,7 +813,6 @@ quartz_draw_button (GtkStyle        *style,
                     gint             width,
                     gint             height)
 {
-  CGContextRef context;
   HIRect rect;
   HIShapeRef shape;
   HIThemeButtonDrawInfo draw_info;
@@ -157,81 +836,41 @@ quartz_draw_button (GtkStyle        *style,
 
   //if (GTK_WIDGET_HAS_FOCUS (widget))
   //  draw_info.adornment |= kThemeAdornmentFocus;
-  //if (IS_DETAIL (detail, "buttondefault"))
-  //  draw_info.adornment |= kThemeAdornmentDefault;
-
-  /* FIXME: Emulate default button pulsing. */
 
   // if the button size is too small or too tall, force the button kind so it looks better..
   // FIXME: magic numbers. not sure if they're correct, just guesses
   if (((width < 20) || (height > 29)) && (kind != kThemeBevelButtonInset)) {
     GtkAllocation allocation;
-    GdkPixmap *pixmap;
-    CGContextRef bitmap_context;
-    CGImageRef image;
+    HIRect bbox;
 
     gtk_widget_get_allocation (widget, &allocation);
 
     draw_info.kind = kThemeBevelButton;
     rect = CGRectMake (x, y, width, height);
+    bbox = CGRectMake (0, 0, allocation.width, allocation.height);
 
-    pixmap = gdk_pixmap_new (GDK_DRAWABLE (window), allocation.width, allocation.height, 32);
-    bitmap_context = get_context (pixmap, NULL);
-
-    if (!bitmap_context)
-      {
-	g_object_unref (pixmap);
-	return;
-      }
+    draw_stretched_button (window, area, &draw_info, &bbox, &rect);
 
-    CGRect bbox = CGRectMake (0, 0, allocation.width, allocation.height);
-
-    HIThemeDrawButton (&bbox,
-		       &draw_info,
-		       bitmap_context,
-		       kHIThemeOrientationNormal,
-		       NULL);
+    if (draw_info.state == kThemeStatePressed)
+      quartz_stats_add_pressed_draw ();
+  } else {
+    line_width = quartz_style_get_focus_line_width (style, widget);
 
-    image = CGBitmapContextCreateImage (bitmap_context);
+    quartz_metrics_button_rect (&draw_info, x + line_width, y + line_width,
+                                width - 2 * line_width, height - 2 * line_width,
+                                &rect);
 
-    context = get_context (window, area);
-    if (!context)
+    if (IS_DETAIL (detail, "buttondefault") &&
+        draw_info.state != kThemeStatePressed)
       {
-	CGImageRelease (image);
-
-	release_context(pixmap, bitmap_context);
-	g_object_unref (pixmap);
-
-	return;
+        draw_default_button (window, widget, &draw_info, &rect);
+        return;
       }
 
-    CGContextDrawImage (context, rect, image);
-
-    release_context (window, context);
-    CGImageRelease (image);
-    release_context (pixmap, bitmap_context);
-    g_object_unref (pixmap);
-  } else {
-    gtk_widget_style_get (widget,
-			  "focus-line-width", &line_width,
-			  NULL);
-
-    rect = CGRectMake (x + line_width, y + line_width,
-		       width - 2 * line_width, height - 2 * line_width - 2);
-
-    context = get_context (window, NULL);
-    if (!context)
-      return;
-
-
-    HIThemeDrawButton (&rect,
-		       &draw_info,
-		       context,
-		       kHIThemeOrientationNormal,
-		       NULL);
-
-
-    release_context (window, context);
+    /* Through the cache, so that the pressed look is rendered ahead
+     * of the click.
+     */
+    quartz_draw_cached_button (window, NULL, &draw_info, &rect);
   }
 }
 
@@ -254,12 +893,16 @@ quartz_draw_menu_checkmark (GtkStyle       *style,
       if (!gtk_check_menu_item_get_active (GTK_CHECK_MENU_ITEM (widget)))
         return;
 
+      static CFStringRef checkString = NULL;
       CGContextRef context;
       HIRect rect;
       HIThemeTextInfo draw_info;
 
-      UniChar uchCheck = kCheckUnicode;
-      CFStringRef checkString = CFStringCreateWithCharacters (NULL, &uchCheck, 1);
+      if (!checkString)
+        {
+          UniChar uchCheck = kCheckUnicode;
+          checkString = CFStringCreateWithCharacters (NULL, &uchCheck, 1);
+        }
 
       draw_info.version = 1;
       draw_info.fontID = kThemeMenuItemMarkFont;
@@ -295,7 +938,6 @@ quartz_draw_menu_checkmark (GtkStyle       *style,
                           context,
                           kHIThemeOrientationNormal);
 
-      CFRelease (checkString);
       release_context (window, context);
 }
 
@@ -362,6 +1004,7 @@ void
 quartz_draw_statusbar (GtkStyle        *style,
 					   GdkWindow       *window,
 					   GtkStateType     state_type,
+					   GdkRectangle    *area,
 					   GtkWidget       *widget,
 					   const gchar     *detail,
 					   gint             x,
@@ -372,40 +1015,44 @@ quartz_draw_statusbar (GtkStyle        *style,
 	if (!window)
 		return;
 
-	CGContextRef context;
-	context = gdk_quartz_drawable_get_context (GDK_WINDOW_OBJECT (window)->impl, FALSE);
-	if (!context)
+	if (quartz_stats_enabled ())
+		quartz_stats_add_primitive (G_STRFUNC, detail, window, area, x, y, width, height);
+
+	if (quartz_expose_merge_fill (window, area, x, y, width, height))
 		return;
 
 	NSWindow* wnd = gdk_quartz_window_get_nswindow (window);
 	if (!wnd)
 		return;
 
+	/* Clipped to the exposed area, the gradient spans the whole window. */
+	CGContextRef context = get_context (window, area);
+	if (!context)
+		return;
+
 	if ([wnd backgroundColor] && [[wnd backgroundColor] isKindOfClass: [WindowGradientHelper class]]) {
 		WindowGradientHelper* helper = (WindowGradientHelper*)[wnd backgroundColor];
 		[helper setStatusbarHeight: height];
 	}
 
-	BOOL isMain = [wnd isMainWindow];
+	BOOL isMain = quartz_main_state_track (window, x, y, width, height);
 	NSRect frame = [wnd frame];
 
 	float titlebarHeight = [WindowGradientHelper titleBarHeight];
 
-	CGContextSaveGState (context);
 	CGContextAddRect (context, CGRectMake (x, y, width, height));
 	CGContextClip (context);
 
 	CGContextScaleCTM(context, 1.0f, -1.0f);
 	CGContextTranslateCTM(context, 0.0f, -(frame.size.height - titlebarHeight));
 
-	CGContextBeginPath (context);
-	CGContextAddRect (context, CGRectMake (0.0f, 0.0f, frame.size.width, height - 2));
-	CGContextDrawLinearGradient (context, isMain? [WindowGradientHelper activeStatus] : [WindowGradientHelper inactiveStatus], CGPointMake (0.0f, height - 2), CGPointMake (0.0f, 0.0f), 0);
+	quartz_draw_window_gradient (window, context,
+								 isMain? [WindowGradientHelper activeStatus] : [WindowGradientHelper inactiveStatus],
+								 CGRectMake (0.0f, 0.0f, frame.size.width, height - 2));
 
 	DrawNativeGreyColorInRect(context, statusbarFirstTopBorderGrey, CGRectMake(0.0f, height - 1, frame.size.width, 0.5f), isMain);
 	DrawNativeGreyColorInRect(context, statusbarSecondTopBorderGrey, CGRectMake(0.0f, height - 1.5, frame.size.width, 0.5f), isMain);
 
-	CGContextRestoreGState (context);
-	gdk_quartz_drawable_release_context (GDK_WINDOW_OBJECT (window)->impl, context);
+	release_context (window, context);
 }
 
@@ -22,6 +22,9 @@
 #ifndef QUARTZ_DRAW_H
 #define QUARTZ_DRAW_H
 
+/* Width wide list headers are rendered at before being stretched. */
+#define QUARTZ_LIST_HEADER_TEMPLATE_WIDTH 32
+
 CGContextRef
 get_context (GdkWindow    *window,
              GdkRectangle *area);
@@ -31,6 +34,63 @@ release_context (GdkWindow    *window,
                  CGContextRef  context);
 
 
+void
+quartz_render_button (CGContextRef  context,
+                      const HIRect *rect,
+                      gpointer      user_data);
+
+void
+quartz_render_popup_arrow (CGContextRef  context,
+                           const HIRect *rect,
+                           gpointer      user_data);
+
+void
+quartz_draw_popup_arrow (GdkWindow                       *window,
+                         GdkRectangle                    *area,
+                         const HIThemePopupArrowDrawInfo *draw_info,
+                         const HIRect                    *rect);
+
+void
+quartz_draw_cached_button (GdkWindow             *window,
+                           GdkRectangle          *area,
+                           HIThemeButtonDrawInfo *draw_info,
+                           const HIRect          *rect);
+
+void
+quartz_draw_track (GdkWindow            *window,
+                   GdkRectangle         *area,
+                   HIThemeTrackDrawInfo *draw_info);
+
+void
+quartz_draw_slider (GdkWindow            *window,
+                    GdkRectangle         *area,
+                    HIThemeTrackDrawInfo *draw_info);
+
+void
+quartz_draw_list_header (GdkWindow             *window,
+                         GdkRectangle          *area,
+                         HIThemeButtonDrawInfo *draw_info,
+                         const HIRect          *rect);
+
+gboolean
+quartz_window_in_live_resize (GdkWindow *window);
+
+void
+quartz_draw_set_live_resize_forced (gboolean forced);
+
+void
+quartz_draw_window_gradient (GdkWindow     *window,
+                             CGContextRef   context,
+                             CGGradientRef  gradient,
+                             CGRect         rect);
+
+void
+quartz_draw_window_placard (GdkWindow                    *window,
+                            GdkRectangle                 *area,
+                            const HIThemePlacardDrawInfo *draw_info,
+                            const HIRect                 *rect);
+
+
 void quartz_draw_button (GtkStyle        *style,
                          GdkWindow       *window,
                          GtkStateType     state_type,
@@ -70,6 +130,7 @@ void
 quartz_draw_statusbar (GtkStyle        *style,
 					   GdkWindow       *window,
 					   GtkStateType     state_type,
+					   GdkRectangle    *area,
 					   GtkWidget       *widget,
 					   const gchar     *detail,
 					   gint             x,
@@ -0,0 +1,136 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Remembers which background fills were already painted during the
+ * current expose of each window. Some fills get requested over and
+ * over within one expose, most notably the statusbar gradient, which
+ * is repainted for every child of the statusbar. Enabled by setting
+ * QUARTZ_MERGE_FILLS.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+
+#include "quartz-expose.h"
+#include "quartz-stats.h"
+
+static gboolean enabled = FALSE;
+
+/* GdkWindow -> GdkRegion painted so far in its current expose. */
+static GHashTable *painted = NULL;
+
+static gboolean
+expose_hook (GSignalInvocationHint *hint,
+             guint                  n_params,
+             const GValue          *params,
+             gpointer               data)
+{
+  GtkWidget *widget;
+  GdkEventExpose *event;
+  gpointer owner;
+
+  widget = g_value_get_object (&params[0]);
+  event = g_value_get_boxed (&params[1]);
+
+  /* Windowless children are exposed as part of their parent's expose,
+   * a new expose only starts with the widget owning the window.
+   */
+  gdk_window_get_user_data (event->window, &owner);
+  if (owner == widget)
+    g_hash_table_remove (painted, event->window);
+
+  return TRUE;
+}
+
+static void
+window_destroyed (gpointer  data,
+                  GObject  *window)
+{
+  g_hash_table_remove (painted, window);
+}
+
+void
+quartz_expose_init (void)
+{
+  if (enabled || !g_getenv ("QUARTZ_MERGE_FILLS"))
+    return;
+
+  enabled = TRUE;
+
+  painted = g_hash_table_new_full (NULL, NULL, NULL,
+                                   (GDestroyNotify) gdk_region_destroy);
+
+  g_signal_add_emission_hook (g_signal_lookup ("expose-event", GTK_TYPE_WIDGET),
+                              0, expose_hook, NULL, NULL);
+}
+
+/* Call before painting an opaque fill that doesn't depend on anything
+ * painted earlier. Returns TRUE if the same area was already filled
+ * during this expose of window and the fill can be skipped, otherwise
+ * records the area. Only the part of the fill inside area, the clip
+ * the fill is painted with, is recorded; area can be NULL.
+ */
+gboolean
+quartz_expose_merge_fill (GdkWindow    *window,
+                          GdkRectangle *area,
+                          gint          x,
+                          gint          y,
+                          gint          width,
+                          gint          height)
+{
+  GdkRectangle rect;
+  GdkRegion *region;
+
+  if (!enabled || !window || GDK_IS_PIXMAP (window))
+    return FALSE;
+
+  rect.x = x;
+  rect.y = y;
+  rect.width = width;
+  rect.height = height;
+
+  if (area && !gdk_rectangle_intersect (&rect, area, &rect))
+    return FALSE;
+
+  region = g_hash_table_lookup (painted, window);
+  if (!region)
+    {
+      if (!g_object_get_data (G_OBJECT (window), "quartz-expose-tracked"))
+        {
+          g_object_set_data (G_OBJECT (window), "quartz-expose-tracked", GINT_TO_POINTER (TRUE));
+          g_object_weak_ref (G_OBJECT (window), window_destroyed, NULL);
+        }
+
+      region = gdk_region_rectangle (&rect);
+      g_hash_table_insert (painted, window, region);
+
+      return FALSE;
+    }
+
+  if (gdk_region_rect_in (region, &rect) == GDK_OVERLAP_RECTANGLE_IN)
+    {
+      quartz_stats_add_merged_fill ();
+      return TRUE;
+    }
+
+  gdk_region_union_with_rect (region, &rect);
+
+  return FALSE;
+}
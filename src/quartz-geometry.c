@@ -0,0 +1,100 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "quartz-geometry.h"
+
+void
+quartz_rect_union (const QuartzRect *a,
+                   const QuartzRect *b,
+                   QuartzRect       *dest)
+{
+  gdouble x1, y1, x2, y2;
+
+  if (a->width <= 0 || a->height <= 0)
+    {
+      *dest = *b;
+      return;
+    }
+
+  if (b->width <= 0 || b->height <= 0)
+    {
+      *dest = *a;
+      return;
+    }
+
+  x1 = MIN (a->x, b->x);
+  y1 = MIN (a->y, b->y);
+  x2 = MAX (a->x + a->width, b->x + b->width);
+  y2 = MAX (a->y + a->height, b->y + b->height);
+
+  dest->x = x1;
+  dest->y = y1;
+  dest->width = x2 - x1;
+  dest->height = y2 - y1;
+}
+
+/* Computes where the thumb of a track goes, given the rect the thumb
+ * can travel in (what HIThemeGetTrackDragRect returns). The thumb is
+ * proportional to page_size but never shorter than min_length, which
+ * for sliders (page_size == 0) is simply the size of the knob.
+ */
+void
+quartz_track_thumb_rect (const QuartzRect *drag_rect,
+                         gboolean          horizontal,
+                         gdouble           lower,
+                         gdouble           upper,
+                         gdouble           page_size,
+                         gdouble           value,
+                         gdouble           min_length,
+                         QuartzRect       *thumb)
+{
+  gdouble track_length, thumb_length;
+  gdouble range, fraction, offset;
+
+  track_length = horizontal ? drag_rect->width : drag_rect->height;
+  range = upper - lower;
+
+  if (range > 0 && page_size > 0)
+    thumb_length = track_length * MIN (page_size / range, 1.0);
+  else
+    thumb_length = 0;
+
+  thumb_length = CLAMP (thumb_length, MIN (min_length, track_length), track_length);
+
+  if (range - page_size > 0)
+    fraction = CLAMP ((value - lower) / (range - page_size), 0.0, 1.0);
+  else
+    fraction = 0;
+
+  offset = fraction * (track_length - thumb_length);
+
+  *thumb = *drag_rect;
+
+  if (horizontal)
+    {
+      thumb->x += offset;
+      thumb->width = thumb_length;
+    }
+  else
+    {
+      thumb->y += offset;
+      thumb->height = thumb_length;
+    }
+}
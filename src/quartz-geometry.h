@@ -0,0 +1,51 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_GEOMETRY_H
+#define QUARTZ_GEOMETRY_H
+
+#include <glib.h>
+
+/* Plain geometry helpers. They don't depend on Carbon so that they can
+ * be built and checked on any platform.
+ */
+
+typedef struct
+{
+  gdouble x;
+  gdouble y;
+  gdouble width;
+  gdouble height;
+} QuartzRect;
+
+void quartz_rect_union          (const QuartzRect *a,
+                                 const QuartzRect *b,
+                                 QuartzRect       *dest);
+
+void quartz_track_thumb_rect    (const QuartzRect *drag_rect,
+                                 gboolean          horizontal,
+                                 gdouble           lower,
+                                 gdouble           upper,
+                                 gdouble           page_size,
+                                 gdouble           value,
+                                 gdouble           min_length,
+                                 QuartzRect       *thumb);
+
+#endif /* QUARTZ_GEOMETRY_H */
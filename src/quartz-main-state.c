@@ -0,0 +1,151 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Keeps track of what was drawn differently depending on whether its
+ * window is the main window, so that only those parts have to be
+ * repainted when another window becomes main. GTK+ itself doesn't
+ * repaint anything on such a change.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include <AppKit/AppKit.h>
+
+#include "quartz-main-state.h"
+
+/* FIXME: Fix GTK+ to export those in a quartz header file. */
+NSWindow *   gdk_quartz_window_get_nswindow (GdkWindow *window);
+
+typedef struct
+{
+  NSWindow  *wnd;
+  GdkRegion *region;
+} Dependents;
+
+/* GdkWindow -> Dependents, in the coordinates of each GdkWindow. */
+static GHashTable *windows = NULL;
+
+static void
+dependents_free (Dependents *dependents)
+{
+  gdk_region_destroy (dependents->region);
+  g_free (dependents);
+}
+
+static void
+invalidate_dependents (gpointer key,
+                       gpointer value,
+                       gpointer user_data)
+{
+  Dependents *dependents = value;
+
+  if (dependents->wnd != user_data || gdk_region_empty (dependents->region))
+    return;
+
+  gdk_window_invalidate_region (key, dependents->region, TRUE);
+
+  /* Whatever still depends on it gets recorded again when redrawn. */
+  gdk_region_destroy (dependents->region);
+  dependents->region = gdk_region_new ();
+}
+
+@interface QuartzMainStateObserver : NSObject
+@end
+
+@implementation QuartzMainStateObserver
+- (void) mainStateChanged: (NSNotification *)notification
+{
+  g_hash_table_foreach (windows, invalidate_dependents, [notification object]);
+}
+@end
+
+static void
+window_destroyed (gpointer  data,
+                  GObject  *window)
+{
+  g_hash_table_remove (windows, window);
+}
+
+static void
+init (void)
+{
+  QuartzMainStateObserver *observer;
+  NSNotificationCenter *center;
+
+  windows = g_hash_table_new_full (NULL, NULL, NULL,
+                                   (GDestroyNotify) dependents_free);
+
+  observer = [[QuartzMainStateObserver alloc] init];
+  center = [NSNotificationCenter defaultCenter];
+
+  [center addObserver: observer
+             selector: @selector(mainStateChanged:)
+                 name: NSWindowDidBecomeMainNotification
+               object: nil];
+  [center addObserver: observer
+             selector: @selector(mainStateChanged:)
+                 name: NSWindowDidResignMainNotification
+               object: nil];
+}
+
+/* Returns whether the NSWindow of window is the main window, and
+ * remembers that the given rect of window was drawn based on that.
+ * Use this instead of asking the NSWindow directly.
+ */
+gboolean
+quartz_main_state_track (GdkWindow *window,
+                         gint       x,
+                         gint       y,
+                         gint       width,
+                         gint       height)
+{
+  Dependents *dependents;
+  GdkRectangle rect;
+  NSWindow *wnd;
+
+  if (!window || GDK_IS_PIXMAP (window))
+    return TRUE;
+
+  wnd = gdk_quartz_window_get_nswindow (window);
+  if (!wnd)
+    return TRUE;
+
+  if (!windows)
+    init ();
+
+  dependents = g_hash_table_lookup (windows, window);
+  if (!dependents)
+    {
+      dependents = g_new (Dependents, 1);
+      dependents->region = gdk_region_new ();
+      g_hash_table_insert (windows, window, dependents);
+      g_object_weak_ref (G_OBJECT (window), window_destroyed, NULL);
+    }
+
+  dependents->wnd = wnd;
+
+  rect.x = x;
+  rect.y = y;
+  rect.width = width;
+  rect.height = height;
+  gdk_region_union_with_rect (dependents->region, &rect);
+
+  return [wnd isMainWindow];
+}
@@ -0,0 +1,190 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Native control metrics. HITheme draws buttons partly outside the
+ * rect they are given, so these are measured once per kind, adornment
+ * and height and then used both to fit the drawing inside the widget
+ * and to know exactly which pixels it touches.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+
+#include "quartz-metrics.h"
+
+/* Metrics don't depend on the width, as long as it leaves room for
+ * both ends of the button.
+ */
+#define REFERENCE_WIDTH 64
+
+typedef struct
+{
+  guint kind;
+  guint adornment;
+  gint  height;
+} MetricsKey;
+
+/* MetricsKey -> QuartzButtonMetrics, both in one block. */
+static GHashTable *buttons = NULL;
+
+static guint
+metrics_key_hash (gconstpointer key)
+{
+  const MetricsKey *k = key;
+
+  return (k->kind * 31 + k->adornment) * 31 + k->height;
+}
+
+static gboolean
+metrics_key_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const MetricsKey *ka = a, *kb = b;
+
+  return ka->kind == kb->kind &&
+    ka->adornment == kb->adornment &&
+    ka->height == kb->height;
+}
+
+static void
+measure_button (const HIThemeButtonDrawInfo *draw_info,
+                gint                         height,
+                QuartzButtonMetrics         *metrics)
+{
+  HIThemeButtonDrawInfo info = *draw_info;
+  HIRect rect, bounds;
+  HIShapeRef shape;
+
+  /* Only the shape matters, not the look of the current state. */
+  info.state = kThemeStateActive;
+  info.value = kThemeButtonOff;
+
+  rect = CGRectMake (0, 0, REFERENCE_WIDTH, height);
+
+  HIThemeGetButtonBackgroundBounds (&rect, &info, &bounds);
+  if (HIThemeGetButtonShape (&rect, &info, &shape) == noErr)
+    {
+      HIRect shape_bounds;
+
+      HIShapeGetBounds (shape, &shape_bounds);
+      bounds = CGRectUnion (bounds, shape_bounds);
+      CFRelease (shape);
+    }
+
+  metrics->background.left = MAX (CGRectGetMinX (rect) - CGRectGetMinX (bounds), 0);
+  metrics->background.top = MAX (CGRectGetMinY (rect) - CGRectGetMinY (bounds), 0);
+  metrics->background.right = MAX (CGRectGetMaxX (bounds) - CGRectGetMaxX (rect), 0);
+  metrics->background.bottom = MAX (CGRectGetMaxY (bounds) - CGRectGetMaxY (rect), 0);
+}
+
+const QuartzButtonMetrics *
+quartz_metrics_get_button (const HIThemeButtonDrawInfo *draw_info,
+                           gint                         height)
+{
+  struct
+  {
+    MetricsKey          key;
+    QuartzButtonMetrics metrics;
+  } *entry;
+  MetricsKey key;
+
+  key.kind = draw_info->kind;
+  key.adornment = draw_info->adornment;
+  key.height = MAX (height, 1);
+
+  if (!buttons)
+    buttons = g_hash_table_new_full (metrics_key_hash, metrics_key_equal,
+                                     g_free, NULL);
+
+  entry = g_hash_table_lookup (buttons, &key);
+  if (entry)
+    return &entry->metrics;
+
+  entry = g_malloc (sizeof (*entry));
+  entry->key = key;
+  measure_button (draw_info, key.height, &entry->metrics);
+  g_hash_table_insert (buttons, &entry->key, entry);
+
+  return &entry->metrics;
+}
+
+/* Sets rect to the button rect whose painting stays inside the given
+ * area.
+ */
+void
+quartz_metrics_button_rect (const HIThemeButtonDrawInfo *draw_info,
+                            gint                         x,
+                            gint                         y,
+                            gint                         width,
+                            gint                         height,
+                            HIRect                      *rect)
+{
+  const QuartzButtonMetrics *metrics;
+  gint drawn_height;
+
+  /* The outsets are for the rect the button is drawn in, which is
+   * smaller than the area. They only change where HITheme switches
+   * control sizes, so measuring again at the height that is actually
+   * drawn, as quartz_metrics_button_extent() does, is enough.
+   */
+  metrics = quartz_metrics_get_button (draw_info, height);
+  drawn_height = ceil (height - metrics->background.top - metrics->background.bottom);
+  if (drawn_height > 0)
+    metrics = quartz_metrics_get_button (draw_info, drawn_height);
+
+  rect->origin.x = x + metrics->background.left;
+  rect->origin.y = y + metrics->background.top;
+  rect->size.width = MAX (width - metrics->background.left - metrics->background.right, 0);
+  rect->size.height = MAX (height - metrics->background.top - metrics->background.bottom, 0);
+}
+
+/* Sets extent to the pixels touched when drawing the button in rect. */
+void
+quartz_metrics_button_extent (const HIThemeButtonDrawInfo *draw_info,
+                              const HIRect                *rect,
+                              GdkRectangle                *extent)
+{
+  const QuartzButtonMetrics *metrics;
+  gdouble x1, y1, x2, y2;
+
+  metrics = quartz_metrics_get_button (draw_info, ceil (rect->size.height));
+
+  x1 = floor (rect->origin.x - metrics->background.left);
+  y1 = floor (rect->origin.y - metrics->background.top);
+  x2 = ceil (rect->origin.x + rect->size.width + metrics->background.right);
+  y2 = ceil (rect->origin.y + rect->size.height + metrics->background.bottom);
+
+  extent->x = x1;
+  extent->y = y1;
+  extent->width = x2 - x1;
+  extent->height = y2 - y1;
+}
+
+void
+quartz_metrics_shutdown (void)
+{
+  if (buttons)
+    {
+      g_hash_table_destroy (buttons);
+      buttons = NULL;
+    }
+}
@@ -0,0 +1,63 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_METRICS_H
+#define QUARTZ_METRICS_H
+
+/* Distances from each edge of a rect, positive outwards for outsets
+ * and inwards for insets.
+ */
+typedef struct
+{
+  gfloat left;
+  gfloat top;
+  gfloat right;
+  gfloat bottom;
+} QuartzEdges;
+
+typedef struct
+{
+  /* How far HITheme paints outside the rect it draws the button in,
+   * shadows included.
+   */
+  QuartzEdges background;
+} QuartzButtonMetrics;
+
+const QuartzButtonMetrics *
+quartz_metrics_get_button (const HIThemeButtonDrawInfo *draw_info,
+                           gint                         height);
+
+void
+quartz_metrics_button_rect (const HIThemeButtonDrawInfo *draw_info,
+                            gint                         x,
+                            gint                         y,
+                            gint                         width,
+                            gint                         height,
+                            HIRect                      *rect);
+
+void
+quartz_metrics_button_extent (const HIThemeButtonDrawInfo *draw_info,
+                              const HIRect                *rect,
+                              GdkRectangle                *extent);
+
+void
+quartz_metrics_shutdown (void);
+
+#endif /* QUARTZ_METRICS_H */
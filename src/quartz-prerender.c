@@ -0,0 +1,558 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Renders control variants into the render cache before they are
+ * needed. At theme load the most common variants are rendered from
+ * worker threads, so that the first dialog doesn't have to rasterize
+ * them all on the main thread. HITheme is only ever pointed at private
+ * bitmap contexts from these threads. After that, the states a control
+ * is likely to be drawn in next are rendered when the main loop is
+ * idle.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+#include <AppKit/AppKit.h>
+
+#include "quartz-cache.h"
+#include "quartz-draw.h"
+#include "quartz-metrics.h"
+#include "quartz-prerender.h"
+#include "quartz-stats.h"
+#include "WindowGradientHelper.h"
+
+/* GtkCellRendererToggle doesn't have a style property for this. */
+#define CELL_TOGGLE_SIZE 13
+
+/* What a GtkButtonBox gives its buttons unless the rc file says
+ * otherwise, so most dialog buttons are this size.
+ */
+#define BUTTON_BOX_CHILD_WIDTH  85
+#define BUTTON_BOX_CHILD_HEIGHT 27
+
+/* The size the arrows of menu tool buttons and combo-like buttons
+ * usually get. Others are rendered when first drawn.
+ */
+#define ARROW_SIZE 10
+
+typedef enum
+{
+  PRERENDER_BUTTON,
+  PRERENDER_ARROW,
+  PRERENDER_STRIP
+} PrerenderKind;
+
+typedef struct
+{
+  PrerenderKind  kind;
+  QuartzCacheKey key;
+  union
+  {
+    HIThemeButtonDrawInfo     button;
+    HIThemePopupArrowDrawInfo arrow;
+    CGGradientRef             gradient;
+  } u;
+} PrerenderItem;
+
+static GArray        *items = NULL;
+static volatile gint  next_item = 0;
+static volatile gint  stopping = FALSE;
+static GPtrArray     *threads = NULL;
+static guint          scale = 1;
+
+static const ThemeDrawState states[] = {
+  kThemeStateActive, kThemeStatePressed, kThemeStateInactive
+};
+
+static void
+append_item (const PrerenderItem *item)
+{
+  /* Might have been loaded from the cache file already. */
+  if (quartz_cache_contains (&item->key))
+    return;
+
+  g_array_append_val (items, *item);
+}
+
+static void
+add_button (ThemeButtonKind      kind,
+            ThemeDrawState       state,
+            ThemeButtonValue     value,
+            ThemeButtonAdornment adornment,
+            const HIRect        *rect)
+{
+  PrerenderItem item;
+
+  item.kind = PRERENDER_BUTTON;
+  item.u.button.version = 0;
+  item.u.button.kind = kind;
+  item.u.button.state = state;
+  item.u.button.value = value;
+  item.u.button.adornment = adornment;
+
+  quartz_cache_key_init_button (&item.key, scale, &item.u.button, rect, 0);
+  append_item (&item);
+}
+
+static void
+add_item (ThemeButtonKind      kind,
+          ThemeDrawState       state,
+          ThemeButtonValue     value,
+          ThemeButtonAdornment adornment,
+          gint                 size)
+{
+  HIRect rect = CGRectMake (0, 0, size, size);
+
+  add_button (kind, state, value, adornment, &rect);
+}
+
+static void
+add_arrow (ThemeArrowOrientation orientation,
+           ThemeDrawState        state)
+{
+  PrerenderItem item;
+  HIRect rect = CGRectMake (0, 0, ARROW_SIZE, ARROW_SIZE);
+
+  item.kind = PRERENDER_ARROW;
+  item.u.arrow.version = 0;
+  item.u.arrow.state = state;
+  item.u.arrow.orientation = orientation;
+  item.u.arrow.size = kThemeArrow9pt;
+
+  quartz_cache_key_init_arrow (&item.key, scale, &item.u.arrow, &rect);
+  append_item (&item);
+}
+
+static void
+add_strip (CGGradientRef gradient,
+           CGFloat       height)
+{
+  PrerenderItem item;
+
+  if (!gradient)
+    return;
+
+  item.kind = PRERENDER_STRIP;
+  item.u.gradient = gradient;
+
+  [WindowGradientHelper initStripKey: &item.key gradient: gradient height: height scale: scale];
+  append_item (&item);
+}
+
+static gint
+get_style_property_default (GType        type,
+                            const gchar *name,
+                            gint         fallback)
+{
+  GtkWidgetClass *klass;
+  GParamSpec *pspec;
+  gint value = fallback;
+
+  klass = g_type_class_ref (type);
+  pspec = gtk_widget_class_find_style_property (klass, name);
+  if (pspec && G_IS_PARAM_SPEC_INT (pspec))
+    value = G_PARAM_SPEC_INT (pspec)->default_value;
+  g_type_class_unref (klass);
+
+  return value;
+}
+
+/* Mirrors the states draw_check and draw_option end up with. */
+static void
+add_toggle_items (void)
+{
+  static const ThemeButtonValue values[] = {
+    kThemeButtonOff, kThemeButtonOn, kThemeButtonMixed
+  };
+  gint check_size, radio_size;
+  gint i, j;
+
+  check_size = get_style_property_default (GTK_TYPE_CHECK_BUTTON, "indicator-size",
+                                           CELL_TOGGLE_SIZE);
+  radio_size = get_style_property_default (GTK_TYPE_RADIO_BUTTON, "indicator-size",
+                                           CELL_TOGGLE_SIZE);
+
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    for (j = 0; j < G_N_ELEMENTS (values); j++)
+      {
+        add_item (kThemeCheckBox, states[i], values[j], kThemeAdornmentNone, check_size);
+
+        if (values[j] != kThemeButtonMixed)
+          add_item (kThemeRadioButton, states[i], values[j], kThemeAdornmentNone, radio_size);
+      }
+
+  for (j = 0; j < 2; j++)
+    {
+      add_item (kThemeCheckBox, kThemeStateActive, values[j], kThemeAdornmentNone, CELL_TOGGLE_SIZE);
+      add_item (kThemeCheckBox, kThemeStateInactive, values[j], kThemeAdornmentNone, CELL_TOGGLE_SIZE);
+      add_item (kThemeCheckBox, kThemeStatePressed, values[j], kThemeAdornmentNone, CELL_TOGGLE_SIZE);
+      add_item (kThemeCheckBox, kThemeStatePressed, values[j], kThemeAdornmentFocus, CELL_TOGGLE_SIZE);
+    }
+}
+
+/* Mirrors quartz_draw_button for a button box child and
+ * quartz_draw_list_header for the template of a wide column.
+ */
+static void
+add_button_items (void)
+{
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect;
+  SInt32 header_height;
+  gint line_width;
+  gint i;
+
+  line_width = get_style_property_default (GTK_TYPE_BUTTON, "focus-line-width", 1);
+
+  draw_info.version = 0;
+  draw_info.kind = kThemePushButton;
+  draw_info.value = kThemeButtonOff;
+  draw_info.adornment = kThemeAdornmentNone;
+
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    {
+      draw_info.state = states[i];
+      quartz_metrics_button_rect (&draw_info, line_width, line_width,
+                                  BUTTON_BOX_CHILD_WIDTH - 2 * line_width,
+                                  BUTTON_BOX_CHILD_HEIGHT - 2 * line_width,
+                                  &rect);
+      add_button (kThemePushButton, states[i], kThemeButtonOff, kThemeAdornmentNone, &rect);
+    }
+
+  if (GetThemeMetric (kThemeMetricListHeaderHeight, &header_height) != noErr)
+    return;
+
+  /* Tree view headers are drawn one pixel larger on each side. */
+  rect = CGRectMake (0, 0, QUARTZ_LIST_HEADER_TEMPLATE_WIDTH, header_height + 2);
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    add_button (kThemeListHeaderButton, states[i], kThemeButtonOff, kThemeAdornmentNone, &rect);
+}
+
+/* Mirrors draw_arrow, and the gradients of a window without a toolbar
+ * during a live resize.
+ */
+static void
+add_other_items (void)
+{
+  static const ThemeArrowOrientation orientations[] = {
+    kThemeArrowUp, kThemeArrowDown, kThemeArrowLeft, kThemeArrowRight
+  };
+  CGFloat title_height;
+  gint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (orientations); i++)
+    for (j = 0; j < G_N_ELEMENTS (states); j++)
+      add_arrow (orientations[i], states[j] == kThemeStateInactive ?
+                                  kThemeStateUnavailable : states[j]);
+
+  title_height = [WindowGradientHelper titleBarHeight];
+  add_strip ([WindowGradientHelper activeTitle], title_height);
+  add_strip ([WindowGradientHelper inactiveTitle], title_height);
+}
+
+static void
+add_items (void)
+{
+  add_toggle_items ();
+  add_button_items ();
+  add_other_items ();
+}
+
+static CGImageRef
+render_item (PrerenderItem *item)
+{
+  switch (item->kind)
+    {
+    case PRERENDER_BUTTON:
+      return quartz_cache_render_image (&item->key, quartz_render_button, &item->u.button);
+
+    case PRERENDER_ARROW:
+      return quartz_cache_render_image (&item->key, quartz_render_popup_arrow, &item->u.arrow);
+
+    case PRERENDER_STRIP:
+      return [WindowGradientHelper renderStripForGradient: item->u.gradient key: &item->key];
+    }
+
+  return NULL;
+}
+
+static gpointer
+prerender_thread (gpointer data)
+{
+  NSAutoreleasePool *pool;
+  PrerenderItem *item;
+  CGImageRef image;
+  gint i;
+
+  quartz_stats_thread_begin ();
+
+  /* In case AppKit autoreleases anything on this thread. */
+  pool = [[NSAutoreleasePool alloc] init];
+
+  while (!g_atomic_int_get (&stopping) &&
+#if GLIB_CHECK_VERSION (2, 30, 0)
+         (i = g_atomic_int_add (&next_item, 1)) < (gint) items->len)
+#else
+         (i = g_atomic_int_exchange_and_add (&next_item, 1)) < (gint) items->len)
+#endif
+    {
+      item = &g_array_index (items, PrerenderItem, i);
+
+      image = render_item (item);
+      if (image)
+        quartz_cache_insert_from_thread (&item->key, image);
+    }
+
+  [pool release];
+
+  quartz_stats_thread_end ();
+
+  return NULL;
+}
+
+/* Like quartz_prerender_start(), but for the given backing scale
+ * instead of the main screen's.
+ */
+void
+quartz_prerender_start_for_scale (guint n_threads,
+                                  guint for_scale)
+{
+  guint i;
+
+#if !GLIB_CHECK_VERSION (2, 32, 0)
+  if (!g_thread_supported ())
+    return;
+#endif
+
+  if (items)
+    return;
+
+  scale = MAX (1, for_scale);
+
+  items = g_array_new (FALSE, FALSE, sizeof (PrerenderItem));
+  add_items ();
+
+  g_atomic_int_set (&next_item, 0);
+  g_atomic_int_set (&stopping, FALSE);
+
+  quartz_cache_init_threads ();
+
+  threads = g_ptr_array_new ();
+  for (i = 0; i < CLAMP (n_threads, 1, 4); i++)
+    {
+      GThread *thread;
+
+#if GLIB_CHECK_VERSION (2, 32, 0)
+      thread = g_thread_new ("quartz-prerender", prerender_thread, NULL);
+#else
+      thread = g_thread_create (prerender_thread, NULL, TRUE, NULL);
+#endif
+      if (thread)
+        g_ptr_array_add (threads, thread);
+    }
+}
+
+void
+quartz_prerender_start (guint n_threads)
+{
+  NSScreen *screen;
+  guint screen_scale = 1;
+
+  screen = [NSScreen mainScreen];
+  if (screen && [screen respondsToSelector: @selector(backingScaleFactor)])
+    screen_scale = MAX (1, (guint) [screen backingScaleFactor]);
+
+  quartz_prerender_start_for_scale (n_threads, screen_scale);
+}
+
+static void
+join_threads (void)
+{
+  guint i;
+
+  if (!threads)
+    return;
+
+  for (i = 0; i < threads->len; i++)
+    g_thread_join (g_ptr_array_index (threads, i));
+
+  g_ptr_array_free (threads, TRUE);
+  threads = NULL;
+
+  g_array_free (items, TRUE);
+  items = NULL;
+}
+
+/* Waits until the worker threads have rendered everything. The images
+ * show up in the cache with the next lookup. Meant for tests and
+ * benchmarks, a later quartz_prerender_start() renders again.
+ */
+void
+quartz_prerender_wait (void)
+{
+  join_threads ();
+}
+
+/* How long a single idle callback may spend rendering, in seconds. */
+#define PREDICT_IDLE_BUDGET 0.002
+
+typedef struct
+{
+  QuartzCacheKey        key;
+  HIThemeButtonDrawInfo draw_info;
+} PredictItem;
+
+static GQueue     *predictions = NULL;
+static GHashTable *predicted = NULL;
+static guint       predict_idle_id = 0;
+
+static gboolean
+predict_idle (gpointer data)
+{
+  PredictItem *item;
+  CGImageRef image;
+  GTimer *timer;
+
+  timer = g_timer_new ();
+
+  while (g_timer_elapsed (timer, NULL) < PREDICT_IDLE_BUDGET &&
+         (item = g_queue_pop_head (predictions)))
+    {
+      g_hash_table_remove (predicted, &item->key);
+
+      if (!quartz_cache_contains (&item->key))
+        {
+          image = quartz_cache_render_image (&item->key, quartz_render_button, &item->draw_info);
+          if (image)
+            quartz_cache_insert_speculative (&item->key, image);
+        }
+
+      g_free (item);
+    }
+
+  g_timer_destroy (timer);
+
+  if (g_queue_is_empty (predictions))
+    {
+      predict_idle_id = 0;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+queue_prediction (guint                        scale,
+                  const HIThemeButtonDrawInfo *draw_info,
+                  const HIRect                *rect,
+                  ThemeDrawState               state,
+                  ThemeButtonValue             value)
+{
+  PredictItem *item;
+
+  item = g_new (PredictItem, 1);
+  item->draw_info = *draw_info;
+  item->draw_info.state = state;
+  item->draw_info.value = value;
+
+  quartz_cache_key_init_button (&item->key, scale, &item->draw_info, rect, 0);
+
+  if (quartz_cache_contains (&item->key) ||
+      g_hash_table_lookup (predicted, &item->key))
+    {
+      g_free (item);
+      return;
+    }
+
+  g_hash_table_insert (predicted, &item->key, item);
+  g_queue_push_tail (predictions, item);
+
+  if (!predict_idle_id)
+    predict_idle_id = g_idle_add_full (G_PRIORITY_LOW, predict_idle, NULL, NULL);
+}
+
+/* Queues the variants a button that was just drawn is likely to be
+ * drawn in next: pressed while the mouse is down, and with the other
+ * value once a check box or radio button is released.
+ */
+void
+quartz_prerender_predict_button (guint                        scale,
+                                 const HIThemeButtonDrawInfo *draw_info,
+                                 const HIRect                *rect)
+{
+  ThemeButtonValue toggled;
+  gboolean toggles;
+
+  if (draw_info->state != kThemeStateActive &&
+      draw_info->state != kThemeStatePressed)
+    return;
+
+  if (!predictions)
+    {
+      predictions = g_queue_new ();
+      predicted = g_hash_table_new (quartz_cache_key_hash, quartz_cache_key_equal);
+    }
+
+  toggles = (draw_info->kind == kThemeCheckBox ||
+             draw_info->kind == kThemeRadioButton);
+  toggled = draw_info->value == kThemeButtonOn ? kThemeButtonOff : kThemeButtonOn;
+
+  if (draw_info->state == kThemeStateActive)
+    {
+      queue_prediction (scale, draw_info, rect, kThemeStatePressed, draw_info->value);
+      if (toggles)
+        queue_prediction (scale, draw_info, rect, kThemeStateActive, toggled);
+    }
+  else
+    {
+      queue_prediction (scale, draw_info, rect, kThemeStateActive, draw_info->value);
+      if (toggles)
+        queue_prediction (scale, draw_info, rect, kThemeStateActive, toggled);
+    }
+}
+
+/* Stops the worker threads and waits for them, so none of them is
+ * still rendering into the cache when it goes away, and drops pending
+ * predictions. Must be called before quartz_cache_shutdown().
+ */
+void
+quartz_prerender_shutdown (void)
+{
+  g_atomic_int_set (&stopping, TRUE);
+  join_threads ();
+  quartz_cache_shutdown_threads ();
+
+  if (predict_idle_id)
+    {
+      g_source_remove (predict_idle_id);
+      predict_idle_id = 0;
+    }
+
+  if (predictions)
+    {
+      g_hash_table_destroy (predicted);
+      predicted = NULL;
+
+      g_queue_foreach (predictions, (GFunc) g_free, NULL);
+      g_queue_free (predictions);
+      predictions = NULL;
+    }
+}
@@ -0,0 +1,37 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_PRERENDER_H
+#define QUARTZ_PRERENDER_H
+
+void quartz_prerender_start           (guint                        n_threads);
+
+void quartz_prerender_start_for_scale (guint                        n_threads,
+                                       guint                        for_scale);
+
+void quartz_prerender_wait            (void);
+
+void quartz_prerender_predict_button  (guint                        scale,
+                                       const HIThemeButtonDrawInfo *draw_info,
+                                       const HIRect                *rect);
+
+void quartz_prerender_shutdown        (void);
+
+#endif /* QUARTZ_PRERENDER_H */
@@ -38,7 +38,8 @@ GType quartz_type_rc_style = 0;
 
 enum
 {
-	TOKEN_BUTTONTYPE
+	TOKEN_BUTTONTYPE = G_TOKEN_LAST + 1,
+	TOKEN_CACHESIZE
 };
 
 struct
@@ -48,7 +49,8 @@ struct
 }
 theme_symbols[] =
 {
-	{ "buttontype",           TOKEN_BUTTONTYPE }
+	{ "buttontype",           TOKEN_BUTTONTYPE },
+	{ "cachesize",            TOKEN_CACHESIZE }
 };
 
 const gchar* button_types[] =
@@ -85,6 +87,7 @@ static void
 quartz_rc_style_init (QuartzRcStyle * style)
 {
 	style->button_type = 0;
+	style->cache_size = 0;
 }
 
 static void
@@ -131,6 +134,26 @@ guartz_rc_parse_enum (GScanner *scanner, const gchar **choices, guint *selected)
 	return G_TOKEN_NONE;
 }
 
+static guint
+quartz_rc_parse_int (GScanner *scanner, guint *value)
+{
+	guint token;
+
+	token = g_scanner_get_next_token (scanner);
+
+	token = g_scanner_get_next_token (scanner);
+	if (token != G_TOKEN_EQUAL_SIGN)
+		return G_TOKEN_EQUAL_SIGN;
+
+	token = g_scanner_get_next_token (scanner);
+	if (token != G_TOKEN_INT)
+		return G_TOKEN_INT;
+
+	*value = scanner->value.v_int;
+
+	return G_TOKEN_NONE;
+}
+
 static guint
 quartz_rc_style_parse (GtkRcStyle  *rc_style, GtkSettings *settings,
 					   GScanner    *scanner)
@@ -171,6 +194,10 @@ quartz_rc_style_parse (GtkRcStyle  *rc_style, GtkSettings *settings,
 				token = guartz_rc_parse_enum (scanner, button_types, &quartz_style->button_type);
 				break;
 
+			case TOKEN_CACHESIZE:
+				token = quartz_rc_parse_int (scanner, &quartz_style->cache_size);
+				break;
+
 			default:
 				g_scanner_get_next_token (scanner);
 				token = G_TOKEN_RIGHT_CURLY;
@@ -206,4 +233,6 @@ quartz_rc_style_merge (GtkRcStyle *dest, GtkRcStyle *src)
 	//	dest_w->button_type = src_w->button_type;
 	if (!dest_w->button_type)
 		dest_w->button_type = src_w->button_type;
+	if (!dest_w->cache_size)
+		dest_w->cache_size = src_w->cache_size;
 }
@@ -45,6 +45,7 @@ struct _QuartzRcStyle
 {
   GtkRcStyle parent_instance;
   guint button_type;
+  guint cache_size; /* in megabytes, 0 if unset */
 };
 
 struct _QuartzRcStyleClass
@@ -0,0 +1,832 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Drawing statistics, collected when QUARTZ_STATS is set and printed
+ * at exit. With QUARTZ_STATS=verbose a line is
+ * printed for every frame as well.
+ *
+ * A frame is everything that is drawn in one main loop iteration. The
+ * area of each primitive, clipped to the expose area it is drawn for,
+ * is compared to the area that was actually exposed, which gives the
+ * overdraw factor.
+ *
+ * Each expose of a window is also timed from the start of its first
+ * engine call to the end of its last one. Exposes over the budget set
+ * with QUARTZ_FRAME_BUDGET (in milliseconds, 16 by default) are
+ * reported along with the calls that took longest. QUARTZ_TRACE=file
+ * writes every call and expose in the Chrome trace event format.
+ *
+ * Button and key presses are timed until the end of the call that
+ * draws a control in its pressed state, and the median and 99th
+ * percentile of that input latency are reported.
+ *
+ * QUARTZ_CPU_TIME adds the CPU time of the main thread to the timing
+ * of each call. It is steadier than wall time on a loaded machine, and
+ * the difference between the two is time spent waiting, mostly on the
+ * window server.
+ *
+ * With QUARTZ_ALLOC_AUDIT set, the malloc blocks each call leaves
+ * allocated are counted as well. Autoreleased CF and Cocoa objects
+ * count too, since the pool is only drained by the main loop. Once
+ * the caches are warm, redrawing the same thing should not allocate
+ * at all, so every expose that does is reported. The zone statistics
+ * are process wide, so calls made while other threads allocate would
+ * be blamed for their blocks. Calls made while the prerender workers
+ * run are not counted; other threads, e.g. Cocoa's, can still add
+ * noise now and then.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <malloc/malloc.h>
+#include <mach/mach.h>
+
+#include "quartz-stats.h"
+
+/* Runs after GDK has processed all pending exposes. */
+#define FRAME_END_PRIORITY (GDK_PRIORITY_REDRAW + 10)
+
+#define DEFAULT_FRAME_BUDGET 16
+
+/* Expose latency histogram buckets, in milliseconds: < 1, < 2, < 4,
+ * ... < 64 and the rest.
+ */
+#define N_LATENCY_BUCKETS 8
+
+/* How many calls to name for slow exposes. */
+#define N_SLOW_CALLS 3
+
+/* Inputs that are not followed by a pressed draw within this many
+ * microseconds didn't press anything.
+ */
+#define MAX_INPUT_LATENCY 1000000
+
+struct _QuartzStatsCounter
+{
+  gchar   *name;
+  guint    calls;
+  guint64  pixels;
+
+  /* In microseconds. */
+  gdouble  time;
+  gdouble  cpu_time;
+
+  /* Blocks left allocated by calls, with QUARTZ_ALLOC_AUDIT. */
+  guint64  allocs;
+
+  /* Time spent in the current expose, in microseconds. */
+  gdouble  expose_time;
+  guint    expose_allocs;
+};
+
+typedef QuartzStatsCounter Counter;
+
+static gboolean enabled = FALSE;
+static gboolean report = FALSE;
+static gboolean verbose = FALSE;
+static gboolean audit_allocs = FALSE;
+static gboolean cpu_time = FALSE;
+static thread_act_t main_thread;
+
+/* Threads that render in the background, see quartz_stats_thread_begin(). */
+static volatile gint background_threads = 0;
+
+/* "function detail" -> Counter */
+static GHashTable *counters = NULL;
+static guint       frame_end_id = 0;
+
+static GTimer     *timer = NULL;
+static gdouble     frame_budget = DEFAULT_FRAME_BUDGET * 1000;
+static FILE       *trace = NULL;
+
+/* The expose being drawn. GDK exposes one window at a time, and its
+ * windowless children as part of it.
+ */
+static struct
+{
+  GdkWindow *window;
+  gdouble    first;
+  gdouble    last;
+  guint      allocs;
+  GPtrArray *counters;  /* used during this expose */
+} expose;
+
+/* The last button or key press that has not been drawn yet. */
+static struct
+{
+  GdkEventType type;
+  guint32      time;
+  gdouble      start;
+  gboolean     pending;
+  gboolean     drawn;   /* by the current call */
+  GArray      *latencies;
+} input;
+
+static struct
+{
+  guint   uncleared_exposes;
+  guint64 uncleared_pixels;
+
+  guint   merged_fills;
+
+  guint64 frame_exposed;
+  guint64 frame_drawn;
+  guint   frame_primitives;
+
+  guint   frames;
+  guint64 exposed;
+  guint64 drawn;
+  gdouble max_overdraw;
+
+  guint   latency[N_LATENCY_BUCKETS];
+  guint   slow_exposes;
+
+  guint   exposes;
+  guint   allocating_exposes;
+  guint64 allocs;
+} stats;
+
+/* In microseconds since the engine was loaded. */
+static gdouble
+now (void)
+{
+  return g_timer_elapsed (timer, NULL) * 1000000;
+}
+
+/* CPU time of the main thread in microseconds, or -1. */
+static gdouble
+thread_time (void)
+{
+  thread_basic_info_data_t info;
+  mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+
+  if (thread_info (main_thread, THREAD_BASIC_INFO,
+                   (thread_info_t) &info, &count) != KERN_SUCCESS)
+    return -1;
+
+  return (info.user_time.seconds + info.system_time.seconds) * 1000000.0
+    + info.user_time.microseconds + info.system_time.microseconds;
+}
+
+static guint
+blocks_in_use (void)
+{
+  malloc_statistics_t statistics;
+
+  malloc_zone_statistics (NULL, &statistics);
+
+  return statistics.blocks_in_use;
+}
+
+static void
+trace_event (const gchar *name,
+             const gchar *category,
+             gdouble      start,
+             gdouble      duration)
+{
+  if (!trace)
+    return;
+
+  /* The closing bracket of the array is optional in this format, so
+   * the file stays loadable even if the process crashes.
+   */
+  fprintf (trace, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+           "\"ts\":%.0f,\"dur\":%.0f,\"pid\":%d,\"tid\":1}",
+           name, category, start, duration, (gint) getpid ());
+}
+
+static gint
+compare_expose_time (gconstpointer a,
+                     gconstpointer b)
+{
+  const Counter *ca = *(Counter **) a, *cb = *(Counter **) b;
+
+  if (ca->expose_time == cb->expose_time)
+    return 0;
+
+  return ca->expose_time > cb->expose_time ? -1 : 1;
+}
+
+static void
+expose_end (void)
+{
+  Counter *counter;
+  gdouble latency;
+  gint bucket;
+  guint i;
+
+  if (!expose.window || !expose.counters->len)
+    {
+      expose.window = NULL;
+      return;
+    }
+
+  stats.exposes++;
+  latency = expose.last - expose.first;
+
+  for (bucket = 0; bucket < N_LATENCY_BUCKETS - 1; bucket++)
+    if (latency < (1 << bucket) * 1000)
+      break;
+  stats.latency[bucket]++;
+
+  if (trace)
+    {
+      gchar *name;
+
+      name = g_strdup_printf ("expose %p", expose.window);
+      trace_event (name, "expose", expose.first, latency);
+      g_free (name);
+    }
+
+  if (latency > frame_budget)
+    {
+      stats.slow_exposes++;
+      g_ptr_array_sort (expose.counters, compare_expose_time);
+
+      if (report)
+        {
+          g_print ("quartz-engine slow expose of %p: %.1f ms,", expose.window, latency / 1000);
+          for (i = 0; i < MIN (N_SLOW_CALLS, expose.counters->len); i++)
+            {
+              counter = g_ptr_array_index (expose.counters, i);
+              g_print (" %s %.1f ms", counter->name, counter->expose_time / 1000);
+            }
+          g_print ("\n");
+        }
+    }
+
+  if (expose.allocs > 0)
+    {
+      stats.allocating_exposes++;
+      stats.allocs += expose.allocs;
+
+      if (report)
+        {
+          g_print ("quartz-engine expose of %p allocated %u blocks:", expose.window, expose.allocs);
+          for (i = 0; i < expose.counters->len; i++)
+            {
+              counter = g_ptr_array_index (expose.counters, i);
+              if (counter->expose_allocs)
+                g_print (" %s %u", counter->name, counter->expose_allocs);
+            }
+          g_print ("\n");
+        }
+    }
+
+  for (i = 0; i < expose.counters->len; i++)
+    {
+      counter = g_ptr_array_index (expose.counters, i);
+      counter->expose_time = 0;
+      counter->expose_allocs = 0;
+    }
+  g_ptr_array_set_size (expose.counters, 0);
+
+  expose.window = NULL;
+  expose.allocs = 0;
+}
+
+static gboolean
+frame_end (gpointer data)
+{
+  gdouble overdraw;
+
+  frame_end_id = 0;
+
+  expose_end ();
+
+  if (stats.frame_exposed > 0)
+    {
+      overdraw = (gdouble) stats.frame_drawn / stats.frame_exposed;
+
+      stats.frames++;
+      stats.exposed += stats.frame_exposed;
+      stats.drawn += stats.frame_drawn;
+      stats.max_overdraw = MAX (stats.max_overdraw, overdraw);
+
+      if (verbose)
+        g_print ("quartz-engine frame %u: %u primitives, %" G_GUINT64_FORMAT
+                 " pixels exposed, %" G_GUINT64_FORMAT " drawn, overdraw %.2f\n",
+                 stats.frames, stats.frame_primitives,
+                 stats.frame_exposed, stats.frame_drawn, overdraw);
+    }
+
+  stats.frame_exposed = 0;
+  stats.frame_drawn = 0;
+  stats.frame_primitives = 0;
+
+  return FALSE;
+}
+
+static void
+ensure_frame (void)
+{
+  if (!frame_end_id)
+    frame_end_id = g_idle_add_full (FRAME_END_PRIORITY, frame_end, NULL, NULL);
+}
+
+static gboolean
+expose_hook (GSignalInvocationHint *hint,
+             guint                  n_params,
+             const GValue          *params,
+             gpointer               data)
+{
+  GtkWidget *widget;
+  GdkEventExpose *event;
+  GdkRectangle *rects;
+  gpointer owner;
+  gint n_rects, i;
+
+  widget = g_value_get_object (&params[0]);
+  event = g_value_get_boxed (&params[1]);
+
+  /* Containers pass the same expose on to their windowless children,
+   * only count it for the widget that owns the window.
+   */
+  gdk_window_get_user_data (event->window, &owner);
+  if (owner != widget)
+    return TRUE;
+
+  expose_end ();
+  expose.window = event->window;
+
+  gdk_region_get_rectangles (event->region, &rects, &n_rects);
+  for (i = 0; i < n_rects; i++)
+    stats.frame_exposed += (guint64) rects[i].width * rects[i].height;
+  g_free (rects);
+
+  ensure_frame ();
+
+  return TRUE;
+}
+
+static gboolean
+input_hook (GSignalInvocationHint *hint,
+            guint                  n_params,
+            const GValue          *params,
+            gpointer               data)
+{
+  GdkEvent *event;
+  guint32 time;
+
+  event = g_value_get_boxed (&params[1]);
+  time = gdk_event_get_time (event);
+
+  /* The hook runs for every widget the event propagates to. */
+  if (input.pending && input.type == event->type && input.time == time)
+    return TRUE;
+
+  input.type = event->type;
+  input.time = time;
+  input.start = now ();
+  input.pending = TRUE;
+
+  return TRUE;
+}
+
+static gint
+compare_latencies (gconstpointer a,
+                   gconstpointer b)
+{
+  gdouble la = *(gdouble *) a, lb = *(gdouble *) b;
+
+  if (la == lb)
+    return 0;
+
+  return la < lb ? -1 : 1;
+}
+
+static void
+counter_free (Counter *counter)
+{
+  g_free (counter->name);
+  g_free (counter);
+}
+
+void
+quartz_stats_init (void)
+{
+  const gchar *env, *trace_file, *budget;
+
+  env = g_getenv ("QUARTZ_STATS");
+  trace_file = g_getenv ("QUARTZ_TRACE");
+  audit_allocs = g_getenv ("QUARTZ_ALLOC_AUDIT") != NULL;
+  cpu_time = g_getenv ("QUARTZ_CPU_TIME") != NULL;
+  if ((!env && !trace_file && !audit_allocs && !cpu_time) || enabled)
+    return;
+
+  enabled = TRUE;
+  report = env != NULL || audit_allocs || cpu_time;
+  verbose = env && strcmp (env, "verbose") == 0;
+
+  counters = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                    NULL, (GDestroyNotify) counter_free);
+
+  timer = g_timer_new ();
+  expose.counters = g_ptr_array_new ();
+  input.latencies = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  if (cpu_time)
+    {
+      main_thread = mach_thread_self ();
+      if (thread_time () < 0)
+        {
+          g_warning ("quartz-engine: thread CPU time is not available");
+          cpu_time = FALSE;
+        }
+    }
+
+  budget = g_getenv ("QUARTZ_FRAME_BUDGET");
+  if (budget && atof (budget) > 0)
+    frame_budget = atof (budget) * 1000;
+
+  if (trace_file)
+    {
+      trace = g_fopen (trace_file, "w");
+      if (trace)
+        fprintf (trace, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                 "\"args\":{\"name\":\"%s\"}}",
+                 (gint) getpid (), g_get_prgname () ? g_get_prgname () : "gtk");
+      else
+        g_warning ("quartz-engine: could not open trace file %s", trace_file);
+    }
+
+  g_signal_add_emission_hook (g_signal_lookup ("expose-event", GTK_TYPE_WIDGET),
+                              0, expose_hook, NULL, NULL);
+  g_signal_add_emission_hook (g_signal_lookup ("button-press-event", GTK_TYPE_WIDGET),
+                              0, input_hook, NULL, NULL);
+  g_signal_add_emission_hook (g_signal_lookup ("key-press-event", GTK_TYPE_WIDGET),
+                              0, input_hook, NULL, NULL);
+}
+
+gboolean
+quartz_stats_enabled (void)
+{
+  return enabled;
+}
+
+/* An expose of area where GDK didn't have to clear the background. */
+void
+quartz_stats_add_uncleared (GdkRectangle *area)
+{
+  if (!enabled)
+    return;
+
+  stats.uncleared_exposes++;
+  stats.uncleared_pixels += (guint64) area->width * area->height;
+}
+
+/* A fill that was skipped because it was already painted during the
+ * same expose.
+ */
+void
+quartz_stats_add_merged_fill (void)
+{
+  if (!enabled)
+    return;
+
+  stats.merged_fills++;
+}
+
+/* Sets p50 and p99 to the median and 99th percentile of the input
+ * latency so far, in milliseconds, and returns the number of presses
+ * they are from.
+ */
+guint
+quartz_stats_get_input_latency (gdouble *p50,
+                                gdouble *p99)
+{
+  guint len;
+
+  *p50 = *p99 = 0;
+
+  if (!enabled || !input.latencies->len)
+    return 0;
+
+  len = input.latencies->len;
+  g_array_sort (input.latencies, compare_latencies);
+  *p50 = g_array_index (input.latencies, gdouble, len / 2) / 1000;
+  *p99 = g_array_index (input.latencies, gdouble, len * 99 / 100) / 1000;
+
+  return len;
+}
+
+/* Called while drawing a control in its pressed state. The pending
+ * input, if any, counts as drawn when the current call returns.
+ */
+void
+quartz_stats_add_pressed_draw (void)
+{
+  if (enabled && input.pending)
+    input.drawn = TRUE;
+}
+
+/* Accounts for a primitive drawn by function with detail, covering
+ * the given rect of window. A width or height of -1 means the size of
+ * the window, like in the GtkStyle draw functions.
+ */
+static Counter *
+account (const gchar  *function,
+         const gchar  *detail,
+         GdkWindow    *window,
+         GdkRectangle *area,
+         gint          x,
+         gint          y,
+         gint          width,
+         gint          height)
+{
+  GdkRectangle rect;
+  Counter *counter;
+  gchar *name;
+  guint64 pixels;
+
+  if (width < 0)
+    gdk_drawable_get_size (window, &width, NULL);
+  if (height < 0)
+    gdk_drawable_get_size (window, NULL, &height);
+
+  rect.x = x;
+  rect.y = y;
+  rect.width = width;
+  rect.height = height;
+
+  if (area && !gdk_rectangle_intersect (area, &rect, &rect))
+    rect.width = rect.height = 0;
+
+  pixels = (guint64) rect.width * rect.height;
+
+  name = g_strconcat (function, " ", detail ? detail : "-", NULL);
+  counter = g_hash_table_lookup (counters, name);
+  if (!counter)
+    {
+      counter = g_new0 (Counter, 1);
+      counter->name = name;
+      g_hash_table_insert (counters, counter->name, counter);
+    }
+  else
+    g_free (name);
+
+  counter->calls++;
+  counter->pixels += pixels;
+
+  stats.frame_drawn += pixels;
+  stats.frame_primitives++;
+
+  ensure_frame ();
+
+  return counter;
+}
+
+void
+quartz_stats_add_primitive (const gchar  *function,
+                            const gchar  *detail,
+                            GdkWindow    *window,
+                            GdkRectangle *area,
+                            gint          x,
+                            gint          y,
+                            gint          width,
+                            gint          height)
+{
+  if (enabled && window)
+    account (function, detail, window, area, x, y, width, height);
+}
+
+/* Like quartz_stats_add_primitive() but also times the call, until
+ * the matching quartz_stats_end_call().
+ */
+QuartzStatsCall
+quartz_stats_begin_call (const gchar  *function,
+                         const gchar  *detail,
+                         GdkWindow    *window,
+                         GdkRectangle *area,
+                         gint          x,
+                         gint          y,
+                         gint          width,
+                         gint          height)
+{
+  QuartzStatsCall call = { NULL, 0, 0, 0 };
+
+  if (!enabled || !window)
+    return call;
+
+  call.counter = account (function, detail, window, area, x, y, width, height);
+  if (audit_allocs)
+    call.blocks = blocks_in_use ();
+  if (cpu_time)
+    call.cpu_start = thread_time ();
+  call.start = now ();
+
+  return call;
+}
+
+void
+quartz_stats_end_call (QuartzStatsCall *call)
+{
+  Counter *counter = call->counter;
+  guint allocs = 0;
+  gdouble end;
+
+  if (!counter)
+    return;
+
+  end = now ();
+  counter->time += end - call->start;
+  if (cpu_time)
+    counter->cpu_time += MAX (thread_time () - call->cpu_start, 0);
+  if (audit_allocs && !g_atomic_int_get (&background_threads))
+    {
+      guint blocks = blocks_in_use ();
+
+      if (blocks > call->blocks)
+        allocs = blocks - call->blocks;
+      counter->allocs += allocs;
+    }
+
+  trace_event (counter->name, "draw", call->start, end - call->start);
+
+  if (input.drawn)
+    {
+      gdouble latency = end - input.start;
+
+      if (latency < MAX_INPUT_LATENCY)
+        {
+          g_array_append_val (input.latencies, latency);
+          trace_event ("input", "input", input.start, latency);
+        }
+
+      input.pending = FALSE;
+      input.drawn = FALSE;
+    }
+
+  if (!expose.window)
+    return;
+
+  if (!expose.counters->len)
+    expose.first = call->start;
+  expose.last = end;
+
+  if (counter->expose_time == 0)
+    g_ptr_array_add (expose.counters, counter);
+  counter->expose_time += MAX (end - call->start, 0.001);
+  counter->expose_allocs += allocs;
+  expose.allocs += allocs;
+}
+
+static void
+prepend_counter (gpointer key,
+                 gpointer value,
+                 gpointer user_data)
+{
+  GList **list = user_data;
+
+  *list = g_list_prepend (*list, value);
+}
+
+static gint
+compare_counters (gconstpointer a,
+                  gconstpointer b)
+{
+  const Counter *ca = a, *cb = b;
+
+  if (ca->pixels == cb->pixels)
+    return 0;
+
+  return ca->pixels > cb->pixels ? -1 : 1;
+}
+
+/* Called by threads that render in the background while they run, so
+ * that their allocations aren't blamed on the main thread's calls.
+ */
+void
+quartz_stats_thread_begin (void)
+{
+  g_atomic_int_inc (&background_threads);
+}
+
+void
+quartz_stats_thread_end (void)
+{
+  g_atomic_int_add (&background_threads, -1);
+}
+
+void
+quartz_stats_shutdown (void)
+{
+  GList *list = NULL, *l;
+  Counter *counter;
+  gdouble p50, p99;
+  guint n_presses;
+  gint i;
+
+  if (!enabled)
+    return;
+
+  if (frame_end_id)
+    {
+      g_source_remove (frame_end_id);
+      frame_end (NULL);
+    }
+
+  if (trace)
+    {
+      fprintf (trace, "\n]\n");
+      fclose (trace);
+      trace = NULL;
+    }
+
+  if (cpu_time)
+    mach_port_deallocate (mach_task_self (), main_thread);
+
+  if (!report)
+    return;
+
+  g_print ("quartz-engine stats: %u frames, %" G_GUINT64_FORMAT " pixels exposed, %"
+           G_GUINT64_FORMAT " drawn, overdraw %.2f (max %.2f)\n",
+           stats.frames, stats.exposed, stats.drawn,
+           stats.exposed ? (gdouble) stats.drawn / stats.exposed : 0.0,
+           stats.max_overdraw);
+
+  g_hash_table_foreach (counters, prepend_counter, &list);
+  list = g_list_sort (list, compare_counters);
+
+  for (l = list; l; l = l->next)
+    {
+      counter = l->data;
+      g_print ("  %-40s %8u calls %12" G_GUINT64_FORMAT " pixels %5.1f%%\n",
+               counter->name, counter->calls, counter->pixels,
+               stats.drawn ? 100.0 * counter->pixels / stats.drawn : 0.0);
+    }
+
+  g_print ("quartz-engine stats: %u exposes skipped the background clear, "
+           "%" G_GUINT64_FORMAT " pixels not cleared (%" G_GUINT64_FORMAT " per expose)\n",
+           stats.uncleared_exposes, stats.uncleared_pixels,
+           stats.uncleared_exposes ? stats.uncleared_pixels / stats.uncleared_exposes : 0);
+  g_print ("quartz-engine stats: %u repeated fills merged\n", stats.merged_fills);
+
+  g_print ("quartz-engine stats: expose latency (ms)");
+  for (i = 0; i < N_LATENCY_BUCKETS; i++)
+    {
+      if (i < N_LATENCY_BUCKETS - 1)
+        g_print (" <%d: %u", 1 << i, stats.latency[i]);
+      else
+        g_print (" more: %u", stats.latency[i]);
+    }
+  g_print (", %u over %.0f ms\n", stats.slow_exposes, frame_budget / 1000);
+
+  n_presses = quartz_stats_get_input_latency (&p50, &p99);
+  if (n_presses)
+    g_print ("quartz-engine stats: %u presses drawn, input latency p50 %.1f ms, p99 %.1f ms\n",
+             n_presses, p50, p99);
+
+  if (cpu_time)
+    {
+      g_print ("quartz-engine stats: time per call (us)\n");
+
+      for (l = list; l; l = l->next)
+        {
+          counter = l->data;
+          if (counter->time > 0)
+            g_print ("  %-40s %8.1f wall %8.1f cpu %5.1f%%\n",
+                     counter->name,
+                     counter->time / counter->calls,
+                     counter->cpu_time / counter->calls,
+                     100.0 * counter->cpu_time / counter->time);
+        }
+    }
+
+  if (audit_allocs)
+    {
+      g_print ("quartz-engine stats: %u of %u exposes allocated, %" G_GUINT64_FORMAT " blocks\n",
+               stats.allocating_exposes, stats.exposes, stats.allocs);
+
+      for (l = list; l; l = l->next)
+        {
+          counter = l->data;
+          if (counter->allocs)
+            g_print ("  %-40s %8" G_GUINT64_FORMAT " blocks\n", counter->name, counter->allocs);
+        }
+    }
+
+  g_list_free (list);
+}
@@ -0,0 +1,85 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_STATS_H
+#define QUARTZ_STATS_H
+
+typedef struct _QuartzStatsCounter QuartzStatsCounter;
+
+typedef struct
+{
+  QuartzStatsCounter *counter;
+  gdouble             start;
+  gdouble             cpu_start;
+  guint               blocks;
+} QuartzStatsCall;
+
+void
+quartz_stats_init (void);
+
+gboolean
+quartz_stats_enabled (void);
+
+void
+quartz_stats_add_uncleared (GdkRectangle *area);
+
+void
+quartz_stats_add_merged_fill (void);
+
+void
+quartz_stats_add_pressed_draw (void);
+
+guint
+quartz_stats_get_input_latency (gdouble *p50,
+                                gdouble *p99);
+
+void
+quartz_stats_add_primitive (const gchar  *function,
+                            const gchar  *detail,
+                            GdkWindow    *window,
+                            GdkRectangle *area,
+                            gint          x,
+                            gint          y,
+                            gint          width,
+                            gint          height);
+
+QuartzStatsCall
+quartz_stats_begin_call (const gchar  *function,
+                         const gchar  *detail,
+                         GdkWindow    *window,
+                         GdkRectangle *area,
+                         gint          x,
+                         gint          y,
+                         gint          width,
+                         gint          height);
+
+void
+quartz_stats_end_call (QuartzStatsCall *call);
+
+void
+quartz_stats_thread_begin (void);
+
+void
+quartz_stats_thread_end (void);
+
+void
+quartz_stats_shutdown (void);
+
+#endif /* QUARTZ_STATS_H */
@@ -24,6 +24,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <gtk/gtk.h>
 
 #include <Carbon/Carbon.h>
@@ -31,7 +32,15 @@
 
 #include "quartz-rc-style.h"
 #include "quartz-style.h"
+#include "quartz-cache.h"
+#include "quartz-cache-file.h"
 #include "quartz-draw.h"
+#include "quartz-metrics.h"
+#include "quartz-animation.h"
+#include "quartz-prerender.h"
+#include "quartz-main-state.h"
+#include "quartz-stats.h"
+#include "quartz-expose.h"
 #include "WindowGradientHelper.h"
 
 static GtkStyleClass *parent_class;
@@ -57,16 +66,46 @@ CGError CGSReleaseCIFilter (int cid, void* filter);
 
 static gboolean is_combo_box_child (GtkWidget *widget);
 
+/* Set on windows that are always completely covered by what the
+ * engine draws in them.
+ */
+static GQuark opaque_quark = 0;
+
 static gchar *debug = NULL;
 #define DEBUG_DRAW if (debug && (strcmp (debug, "all") == 0 || strcmp (debug, G_OBJECT_TYPE_NAME (widget)) == 0)) \
     g_print ("%s, %s, %s\n", __PRETTY_FUNCTION__, G_OBJECT_TYPE_NAME (widget), detail);
 
+/* Accounts for the rest of the calling function, up to wherever it
+ * returns.
+ */
+#define STATS_DRAW(x, y, width, height) \
+    QuartzStatsCall stats_call __attribute__ ((cleanup (quartz_stats_end_call))) = \
+    quartz_stats_begin_call (G_STRFUNC, detail, window, area, x, y, width, height)
+
 #define IS_DETAIL(d,x) (d && strcmp (d, x) == 0)
 
 static void
 style_setup_settings (void)
 {
+  const gchar *fps;
+  const gchar *prewarm;
+  const gchar *cache_file;
+
   debug = g_strdup (g_getenv ("DEBUG_DRAW"));
+
+  /* QUARTZ_CACHE_FILE=path keeps rendered images across launches. */
+  cache_file = g_getenv ("QUARTZ_CACHE_FILE");
+  if (cache_file && *cache_file)
+    quartz_cache_file_init (cache_file);
+
+  fps = g_getenv ("QUARTZ_ANIMATION_FPS");
+  if (fps)
+    quartz_animation_set_fps (atoi (fps));
+
+  /* QUARTZ_PREWARM=n renders common controls from n threads. */
+  prewarm = g_getenv ("QUARTZ_PREWARM");
+  if (prewarm)
+    quartz_prerender_start (MAX (1, atoi (prewarm)));
 }
 
 static void
@@ -137,7 +176,6 @@ draw_arrow (GtkStyle      *style,
             gint           width,
             gint           height)
 {
-  CGContextRef context;
   HIRect rect;
   HIThemePopupArrowDrawInfo arrow_info;
 
@@ -159,11 +197,8 @@ draw_arrow (GtkStyle      *style,
       return;
     }
 
-  context = get_context (window, area);
-  if (!context)
-    return;
-
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
   rect = CGRectMake (x, y, width, height);
 
   arrow_info.version = 0;
@@ -199,9 +234,7 @@ draw_arrow (GtkStyle      *style,
 
   arrow_info.size = kThemeArrow9pt;
 
-  HIThemeDrawPopupArrow (&rect, &arrow_info, context, kHIThemeOrientationNormal);
-
-  release_context (window, context);
+  quartz_draw_popup_arrow (window, area, &arrow_info, &rect);
 }
 
 static gboolean
@@ -288,6 +321,62 @@ is_icon_only_button (GtkWidget *widget)
   return FALSE;
 }
 
+static gboolean
+progress_bar_is_indeterminate (GtkWidget *widget)
+{
+  return GTK_PROGRESS (widget)->activity_mode;
+}
+
+static QuartzAnimationState
+progress_bar_animation_state (GtkWidget *widget)
+{
+  if (progress_bar_is_indeterminate (widget))
+    return QUARTZ_ANIMATION_RUN;
+
+  return QUARTZ_ANIMATION_STOP;
+}
+
+/* Called when rect, which is opaque, was drawn into window. If that
+ * covers the whole window, GDK doesn't need to clear the background
+ * before exposes anymore.
+ */
+static void
+cover_window (GdkWindow    *window,
+              GdkRectangle *area,
+              const HIRect *rect)
+{
+  GdkRectangle exposed;
+  gint width, height;
+
+  if (!window || GDK_IS_PIXMAP (window))
+    return;
+
+  gdk_drawable_get_size (window, &width, &height);
+  if (rect->origin.x > 0 || rect->origin.y > 0 ||
+      CGRectGetMaxX (*rect) < width || CGRectGetMaxY (*rect) < height)
+    return;
+
+  if (!g_object_get_qdata (G_OBJECT (window), opaque_quark))
+    {
+      g_object_set_qdata (G_OBJECT (window), opaque_quark, GINT_TO_POINTER (TRUE));
+      gdk_window_set_back_pixmap (window, NULL, FALSE);
+      return;
+    }
+
+  if (quartz_stats_enabled ())
+    {
+      exposed.x = 0;
+      exposed.y = 0;
+      exposed.width = width;
+      exposed.height = height;
+
+      if (area)
+        gdk_rectangle_intersect (area, &exposed, &exposed);
+
+      quartz_stats_add_uncleared (&exposed);
+    }
+}
+
 static void
 draw_box (GtkStyle      *style,
           GdkWindow     *window,
@@ -304,13 +393,15 @@ draw_box (GtkStyle      *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
 	GtkWidget* statusbar = is_in_statusbar(widget);
 	if (statusbar) // FIXME: ugly hack
 	{
 		GtkAllocation statusRect;
 		gtk_widget_get_allocation (statusbar, &statusRect);
-		quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type, statusbar, detail, x, statusRect.y, width, statusRect.height);
+		quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type,
+							   gtk_widget_get_window (statusbar) == window ? area : NULL, statusbar, detail, x, statusRect.y, width, statusRect.height);
 	}
   if (GTK_IS_BUTTON (widget) && is_tree_view_child (widget))
     {
@@ -318,7 +409,6 @@ draw_box (GtkStyle      *style,
        * drawing.
        */
 
-      CGContextRef context;
       HIRect rect;
       HIThemeButtonDrawInfo draw_info;
 
@@ -342,17 +432,7 @@ draw_box (GtkStyle      *style,
        */
       rect = CGRectMake (x - 1, y - 1, width + 2, height + 2);
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawButton (&rect,
-                         &draw_info,
-                         context,
-                         kHIThemeOrientationNormal,
-                         NULL);
-
-      release_context (window, context);
+      quartz_draw_list_header (window, area, &draw_info, &rect);
 
       return;
     }
@@ -380,12 +460,11 @@ draw_box (GtkStyle      *style,
       //if (GTK_WIDGET_HAS_FOCUS (widget))
       //  draw_info.adornment |= kThemeAdornmentFocus;
 
-      gtk_widget_style_get (widget,
-                            "focus-line-width", &line_width,
-                            NULL);
+      line_width = quartz_style_get_focus_line_width (style, widget);
 
-      rect = CGRectMake (x + line_width, y + line_width,
-                         width - 2 * line_width, height - 2 * line_width - 1);
+      quartz_metrics_button_rect (&draw_info, x + line_width, y + line_width,
+                                  width - 2 * line_width, height - 2 * line_width,
+                                  &rect);
 
       context = get_context (window, area);
       if (!context)
@@ -408,7 +487,6 @@ draw_box (GtkStyle      *style,
           /* FIXME: refactor so that we can share this code with
            * normal buttons.
            */
-          CGContextRef context;
           HIRect rect;
           HIThemeButtonDrawInfo draw_info;
 
@@ -432,17 +510,7 @@ draw_box (GtkStyle      *style,
 
           rect = CGRectMake (x, y, width, height);
 
-          context = get_context (window, area);
-          if (!context)
-            return;
-
-          HIThemeDrawButton (&rect,
-                             &draw_info,
-                             context,
-                             kHIThemeOrientationNormal,
-                             NULL);
-
-          release_context (window, context);
+          quartz_draw_list_header (window, area, &draw_info, &rect);
 
           return;
         }
@@ -468,6 +536,8 @@ draw_box (GtkStyle      *style,
 			helper = (WindowGradientHelper*)[wnd backgroundColor];
 		} else {
 			helper = [[WindowGradientHelper alloc] initWithWindow: wnd];
+			[wnd setBackgroundColor: helper];
+			[helper release];
 		}
 
 		/* horrible hack? */
@@ -476,15 +546,21 @@ draw_box (GtkStyle      *style,
 		}
 
 		// we have to subtract 1 because this is clipped, and we need a pixel for the bottom line
-		[helper setToolbarHeight: height - 1];
-		[wnd setBackgroundColor: helper];
+		if ([helper toolbarHeight] != height - 1) {
+			[helper setToolbarHeight: height - 1];
+			/* The window keeps the pattern it made for the old height until the background is set again. */
+			[wnd setBackgroundColor: helper];
+		}
 
 		CGContextRef context = get_context (window, area);
 		if (!context)
 			return;
 
+		gint windowWidth;
+		gdk_drawable_get_size (window, &windowWidth, NULL);
+
 		NSRect frame = [wnd frame];
-		BOOL isMain = [wnd isMainWindow];
+		BOOL isMain = quartz_main_state_track (window, 0, 0, windowWidth, height);
 
 		float titlebarHeight = [WindowGradientHelper titleBarHeight];
 		float gradientHeight = titlebarHeight + (height - 1);
@@ -493,9 +569,9 @@ draw_box (GtkStyle      *style,
 		CGContextScaleCTM(context, 1.0f, -1.0f);
 		CGContextTranslateCTM(context, 0.0f, -(frame.size.height - titlebarHeight));
 
-		CGContextBeginPath (context);
-		CGContextAddRect (context, CGRectMake (0.0f, frame.size.height - gradientHeight, frame.size.width, gradientHeight));
-		CGContextDrawLinearGradient (context, isMain? [WindowGradientHelper activeTitle] : [WindowGradientHelper inactiveTitle], CGPointMake (0.0f, frame.size.height), CGPointMake (0.0f, frame.size.height - gradientHeight), 0);
+		quartz_draw_window_gradient (window, context,
+									 isMain? [WindowGradientHelper activeTitle] : [WindowGradientHelper inactiveTitle],
+									 CGRectMake (0.0f, frame.size.height - gradientHeight, frame.size.width, gradientHeight));
 
 		DrawNativeGreyColorInRect(context, headerBorderGrey, CGRectMake(0.0f, frame.size.height - gradientHeight - 1, frame.size.width, 1.0f), isMain);
 
@@ -600,6 +676,7 @@ draw_box (GtkStyle      *style,
         return;
 
       HIThemeDrawPlacard (&rect, &placard_info, context, kHIThemeOrientationNormal);
+      cover_window (window, area, &rect);
 
       /* And the arrows... */
       draw_info.version = 0;
@@ -655,7 +732,20 @@ draw_box (GtkStyle      *style,
       draw_info.min = 0;
       draw_info.max = 100;
       draw_info.value = gtk_progress_bar_get_fraction (GTK_PROGRESS_BAR (widget)) * 100;
-      draw_info.trackInfo.progress.phase = 0; /* for indeterminate ones */
+      draw_info.trackInfo.progress.phase = 0;
+
+      /* Indeterminate bars are animated from the engine's frame clock,
+       * which redraws all of them on the same tick.
+       */
+      if (progress_bar_is_indeterminate (widget))
+        {
+          GdkRectangle track = { x, y, width, height };
+
+          draw_info.kind = kThemeLargeIndeterminateBar;
+          draw_info.trackInfo.progress.phase = quartz_animation_get_frame ();
+
+          quartz_animation_add (widget, window, &track, progress_bar_animation_state);
+        }
 
       switch (gtk_progress_bar_get_orientation (GTK_PROGRESS_BAR (widget)))
         {
@@ -685,7 +775,6 @@ draw_box (GtkStyle      *style,
     }
   else if (GTK_IS_SCALE (widget) && IS_DETAIL (detail, "trough"))
     {
-      CGContextRef context;
       HIRect rect;
       HIThemeTrackDrawInfo draw_info;
       GtkAdjustment *adj;
@@ -706,9 +795,15 @@ draw_box (GtkStyle      *style,
 
       adj = gtk_range_get_adjustment (GTK_RANGE (widget));
 
-      draw_info.min = adj->lower;
-      draw_info.max = adj->upper;
-      draw_info.value = adj->value;
+      /* Like for scrollbars, map the adjustment onto the whole integer
+       * range, so that fractional ranges like 0..1 don't get truncated.
+       */
+      draw_info.min = 0;
+      draw_info.max = INT_MAX;
+      if (adj->upper > adj->lower)
+        draw_info.value = CLAMP ((adj->value - adj->lower) / (adj->upper - adj->lower), 0, 1) * INT_MAX;
+      else
+        draw_info.value = 0;
 
       draw_info.attributes = kThemeTrackShowThumb | kThemeTrackThumbRgnIsNotGhost;
 
@@ -720,13 +815,7 @@ draw_box (GtkStyle      *style,
 
       draw_info.trackInfo.slider.thumbDir = kThemeThumbPlain;
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawTrack (&draw_info, NULL, context, kHIThemeOrientationNormal);
-
-      release_context (window, context);
+      quartz_draw_slider (window, area, &draw_info);
 
       return;
     }
@@ -736,7 +825,6 @@ draw_box (GtkStyle      *style,
     }
   else if (GTK_IS_SCROLLBAR (widget) && IS_DETAIL (detail, "trough"))
     {
-      CGContextRef context;
       CGRect rect;
       HIThemeTrackDrawInfo draw_info;
       GtkAdjustment *adj;
@@ -781,13 +869,7 @@ draw_box (GtkStyle      *style,
 
       //draw_info.trackInfo.slider.thumbDir = kThemeThumbPlain;
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawTrack (&draw_info, NULL, context, kHIThemeOrientationNormal);
-
-      release_context (window, context);
+      quartz_draw_track (window, area, &draw_info);
 
       return;
     }
@@ -821,6 +903,12 @@ set_background (GtkStyle               *style,
 
     gdk_window_get_user_data (window, &widget);
 
+    if (g_object_get_qdata (G_OBJECT (window), opaque_quark))
+    {
+        gdk_window_set_back_pixmap (window, NULL, FALSE);
+        return;
+    }
+
     if (!GTK_IS_MENU (widget))
     {
         parent_class->set_background (style, window, state_type);
@@ -869,13 +957,13 @@ draw_check (GtkStyle      *style,
             gint           height)
 {
   DEBUG_DRAW;
+  STATS_DRAW (x, y, width, height);
 
   /* FIXME: Refactor and share with the other button drawing
    * functions, and radiobuttons.
    */
   if (IS_DETAIL (detail, "checkbutton"))
     {
-      CGContextRef context;
       HIRect rect;
       HIThemeButtonDrawInfo draw_info;
 
@@ -906,23 +994,12 @@ draw_check (GtkStyle      *style,
 
       rect = CGRectMake (x, y, width, height);
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawButton (&rect,
-                         &draw_info,
-                         context,
-                         kHIThemeOrientationNormal,
-                         NULL);
-
-      release_context (window, context);
+      quartz_draw_cached_button (window, area, &draw_info, &rect);
 
       return;
     }
   else if (IS_DETAIL (detail, "cellcheck"))
     {
-      CGContextRef context;
       HIRect rect;
       HIThemeButtonDrawInfo draw_info;
 
@@ -961,17 +1038,10 @@ draw_check (GtkStyle      *style,
 
       rect = CGRectMake (x, y+1, width, height);
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawButton (&rect,
-                         &draw_info,
-                         context,
-                         kHIThemeOrientationNormal,
-                         NULL);
-
-      release_context (window, context);
+      /* Toggle columns draw one of these per visible row, all the
+       * same, so blit them from the render cache.
+       */
+      quartz_draw_cached_button (window, area, &draw_info, &rect);
 
       return;
     }
@@ -1007,13 +1077,13 @@ draw_option (GtkStyle      *style,
              gint           height)
 {
   DEBUG_DRAW;
+  STATS_DRAW (x, y, width, height);
 
   /* FIXME: Refactor and share with the other button drawing
    * functions, and radiobuttons.
    */
   if (IS_DETAIL (detail, "radiobutton"))
     {
-      CGContextRef context;
       HIRect rect;
       HIThemeButtonDrawInfo draw_info;
 
@@ -1041,17 +1111,7 @@ draw_option (GtkStyle      *style,
 
       rect = CGRectMake (x, y-1, width, height);
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawButton (&rect,
-                         &draw_info,
-                         context,
-                         kHIThemeOrientationNormal,
-                         NULL);
-
-      release_context (window, context);
+      quartz_draw_cached_button (window, area, &draw_info, &rect);
 
       return;
     }
@@ -1129,6 +1189,7 @@ draw_extension (GtkStyle        *style,
                 GtkPositionType  gap_side)
 {
   DEBUG_DRAW;
+  STATS_DRAW (x, y, width, height);
 
   if (widget && GTK_IS_NOTEBOOK (widget) && IS_DETAIL (detail, "tab"))
     {
@@ -1149,19 +1210,13 @@ draw_extension (GtkStyle        *style,
       draw_info.adornment = kHIThemeTabAdornmentTrailingSeparator;
       draw_info.kind = kHIThemeTabKindNormal;
 
-#if 0
-      /* This is something that we should do but first we have to make GTK+
-       * invalidate the entire window when losing focus. Split the test out
-       * and share it in all drawing functions.
-       */
-      if (!gtk_window_has_toplevel_focus (GTK_WINDOW (gtk_widget_get_toplevel (widget))))
-        ...
-#endif
-
-      if (state_type == GTK_STATE_ACTIVE)
-        draw_info.style = kThemeTabNonFront;
-      else if (state_type == GTK_STATE_INSENSITIVE)
+      if (state_type == GTK_STATE_INSENSITIVE)
         draw_info.style = kThemeTabNonFrontInactive;
+      else if (!quartz_main_state_track (window, x, y - 1, width, height))
+        draw_info.style = state_type == GTK_STATE_ACTIVE ?
+          kThemeTabNonFrontInactive : kThemeTabFrontInactive;
+      else if (state_type == GTK_STATE_ACTIVE)
+        draw_info.style = kThemeTabNonFront;
       else
         draw_info.style = kThemeTabFront;
 
@@ -1199,6 +1254,11 @@ draw_extension (GtkStyle        *style,
       release_context (window, context);
     }
 
+  /* Drawn on top of the tab above, counted separately. */
+  if (quartz_stats_enabled ())
+    quartz_stats_add_primitive ("parent draw_extension", detail, window, area,
+                                x, y, width, height);
+
   parent_class->draw_extension (style, window, state_type,
                                 shadow_type, area, widget, detail,
                                 x, y, width, height, gap_side);
@@ -1222,6 +1282,7 @@ draw_box_gap (GtkStyle        *style,
               gint             gap_width)
 {
   DEBUG_DRAW;
+  STATS_DRAW (x, y, width, height);
 
 
   parent_class->draw_box_gap (style, window, state_type, shadow_type,
@@ -1246,13 +1307,15 @@ draw_flat_box (GtkStyle      *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
   GtkWidget* statusbar = is_in_statusbar(widget);
   if (statusbar) // FIXME: ugly hack
   {
 	  GtkAllocation statusRect;
 	  gtk_widget_get_allocation (statusbar, &statusRect);
-	  quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type, statusbar, detail, x - 2, statusRect.y - 1, width + 4, statusRect.height + 4);
+	  quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type,
+							   gtk_widget_get_window (statusbar) == window ? area : NULL, statusbar, detail, x - 2, statusRect.y - 1, width + 4, statusRect.height + 4);
 
       return;
   }
@@ -1262,7 +1325,6 @@ draw_flat_box (GtkStyle      *style,
     {
       HIThemePlacardDrawInfo draw_info;
       HIRect rect;
-      CGContextRef context;
 
       gdk_window_get_size (window, &width, &height);
 
@@ -1274,13 +1336,8 @@ draw_flat_box (GtkStyle      *style,
       draw_info.version = 0;
       draw_info.state = kThemeStateActive;
 
-      context = get_context (window, area);
-      if (!context)
-        return;
-
-      HIThemeDrawPlacard (&rect, &draw_info, context, kHIThemeOrientationNormal);
-
-      release_context (window, context);
+      quartz_draw_window_placard (window, area, &draw_info, &rect);
+      cover_window (window, area, &rect);
 
       return;
     }
@@ -1305,6 +1362,7 @@ draw_flat_box (GtkStyle      *style,
         return;
 
       HIThemeDrawPlacard (&rect, &placard_info, context, kHIThemeOrientationNormal);
+      cover_window (window, area, &rect);
 
       release_context (window, context);
 
@@ -1364,6 +1422,7 @@ draw_shadow (GtkStyle      *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
   /* Handle shadow in and etched in for scrolled windows, frames and
    * entries.
@@ -1373,7 +1432,7 @@ draw_shadow (GtkStyle      *style,
 		if (height <= 1)
 			return;
 
-		quartz_draw_statusbar (style, window, state_type, widget, detail, x, y, width, height);
+		quartz_draw_statusbar (style, window, state_type, area, widget, detail, x, y, width, height);
 
 		return;
     }
@@ -1455,6 +1514,7 @@ draw_shadow_gap (GtkStyle        *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
   g_print ("Missing implementation of draw_shadow_gap for %s\n", detail);
 
@@ -1595,6 +1655,7 @@ draw_resize_grip (GtkStyle      *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
   CGContextRef context;
 /*
@@ -1650,7 +1711,8 @@ draw_resize_grip (GtkStyle      *style,
 	if (IS_DETAIL(detail, "statusbar") && (statusbar = is_in_statusbar(widget))) {
 		GtkAllocation statusRect;
 		gtk_widget_get_allocation (statusbar, &statusRect);
-		quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type, statusbar, detail, x, statusRect.y, width, statusRect.height);
+		quartz_draw_statusbar (style, gtk_widget_get_window (statusbar), state_type,
+							   gtk_widget_get_window (statusbar) == window ? area : NULL, statusbar, detail, x, statusRect.y, width, statusRect.height);
 	}
 
 	context = get_context (window, area);
@@ -1675,12 +1737,18 @@ draw_resize_grip (GtkStyle      *style,
 	// ... but only if its supported!
 	if ([themeFrame respondsToSelector:@selector(_drawGrowBoxWithClip:)]) {
 
+		/* A wrapper per draw, in a pool of its own so that it is gone
+		 * before the call returns instead of piling up until the main
+		 * loop drains.
+		 */
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
 		NSGraphicsContext* old = [NSGraphicsContext currentContext];
 		NSGraphicsContext* ngctx = [NSGraphicsContext graphicsContextWithGraphicsPort: context flipped: NO];
 
 		[NSGraphicsContext setCurrentContext: ngctx];
 		[themeFrame _drawGrowBoxWithClip: NSMakeRect (x,  0, width, height)];
 		[NSGraphicsContext setCurrentContext: old];
+		[pool release];
 
 	}
 
@@ -1705,6 +1773,7 @@ draw_handle (GtkStyle       *style,
   DEBUG_DRAW;
 
   sanitize_size (window, &width, &height);
+  STATS_DRAW (x, y, width, height);
 
   if (GTK_IS_PANED (widget) && IS_DETAIL (detail, "paned"))
     {
@@ -1800,6 +1869,38 @@ draw_layout (GtkStyle     *style,
 
 }
 
+/* Style properties only change with the rc style, so they are looked
+ * up once per widget type instead of through gtk_widget_style_get() on
+ * every draw.
+ */
+gint
+quartz_style_get_focus_line_width (GtkStyle  *style,
+                                   GtkWidget *widget)
+{
+  QuartzStyle *quartz_style = QUARTZ_STYLE (style);
+  GType type = G_OBJECT_TYPE (widget);
+  gpointer cached;
+  gint line_width;
+
+  if (!quartz_style->focus_line_widths)
+    quartz_style->focus_line_widths = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  cached = g_hash_table_lookup (quartz_style->focus_line_widths, GSIZE_TO_POINTER (type));
+  if (cached)
+    return GPOINTER_TO_INT (cached) - 1;
+
+  gtk_widget_style_get (widget,
+                        "focus-line-width", &line_width,
+                        NULL);
+
+  /* Don't cache what a widget with another style reports. */
+  if (gtk_widget_get_style (widget) == style)
+    g_hash_table_insert (quartz_style->focus_line_widths,
+                         GSIZE_TO_POINTER (type), GINT_TO_POINTER (line_width + 1));
+
+  return line_width;
+}
+
 static void
 quartz_style_init_from_rc (GtkStyle   *style,
                            GtkRcStyle *rc_style)
@@ -1807,6 +1908,9 @@ quartz_style_init_from_rc (GtkStyle   *style,
   QuartzStyle *quartz_style = QUARTZ_STYLE (style);
   parent_class->init_from_rc (style, rc_style);
 
+  if (quartz_style->focus_line_widths)
+    g_hash_table_remove_all (quartz_style->focus_line_widths);
+
   //style_setup_system_font (style);
 
   switch (QUARTZ_RC_STYLE (rc_style)->button_type) {
@@ -1828,6 +1932,10 @@ quartz_style_init_from_rc (GtkStyle   *style,
 	  break;
   }
 
+  /* The render cache is shared, so the last style that sets a size wins. */
+  if (QUARTZ_RC_STYLE (rc_style)->cache_size)
+    quartz_cache_set_budget ((gsize) QUARTZ_RC_STYLE (rc_style)->cache_size * 1024 * 1024);
+
 
 
 }
@@ -1908,13 +2016,29 @@ quartz_style_unrealize (GtkStyle *style)
   parent_class->unrealize (style);
 }
 
+static void
+quartz_style_finalize (GObject *object)
+{
+  QuartzStyle *quartz_style = QUARTZ_STYLE (object);
+
+  if (quartz_style->focus_line_widths)
+    g_hash_table_destroy (quartz_style->focus_line_widths);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 quartz_style_class_init (QuartzStyleClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkStyleClass *style_class = GTK_STYLE_CLASS (klass);
 
   parent_class = g_type_class_peek_parent (klass);
 
+  object_class->finalize = quartz_style_finalize;
+
+  opaque_quark = g_quark_from_static_string ("quartz-opaque");
+
   style_class->draw_arrow = draw_arrow;
   style_class->draw_box = draw_box;
   style_class->draw_check = draw_check;
@@ -1963,10 +2087,48 @@ quartz_style_register_type (GTypeModule *module)
                                                    &object_info, 0);
 }
 
+static gboolean running = FALSE;
+
 void
 quartz_style_init (void)
 {
+  static gboolean exit_registered = FALSE;
+
+  /* GTK+ never unloads the engine at a normal exit, so theme_exit()
+   * doesn't run then. Shut down from atexit() too, so the reports, the
+   * trace and the cache file still get written.
+   */
+  if (!exit_registered)
+    {
+      atexit (quartz_style_exit);
+      exit_registered = TRUE;
+    }
+
+  running = TRUE;
+
+  quartz_cache_init ();
+  quartz_stats_init ();
+  quartz_expose_init ();
+
+  /* Before the settings, which start the prerender threads. */
+  [WindowGradientHelper createGradients];
+
   style_setup_settings ();
   style_setup_rc_styles ();
-  [WindowGradientHelper createGradients];
+}
+
+void
+quartz_style_exit (void)
+{
+  /* Runs from both theme_exit() and atexit(). */
+  if (!running)
+    return;
+
+  running = FALSE;
+
+  quartz_prerender_shutdown ();
+  quartz_cache_file_shutdown ();
+  quartz_cache_shutdown ();
+  quartz_metrics_shutdown ();
+  quartz_stats_shutdown ();
 }
@@ -39,6 +39,9 @@ struct _QuartzStyle
 {
   GtkStyle parent_instance;
   guint theme_button_kind;
+
+  /* Widget GType -> focus-line-width + 1, filled in as widgets are drawn. */
+  GHashTable *focus_line_widths;
 };
 
 struct _QuartzStyleClass
@@ -48,5 +51,9 @@ struct _QuartzStyleClass
 
 void quartz_style_register_type (GTypeModule *module);
 void quartz_style_init          (void);
+void quartz_style_exit          (void);
+
+gint quartz_style_get_focus_line_width (GtkStyle  *style,
+                                        GtkWidget *widget);
 
 #endif /* QUARTZ_STYLE_H */
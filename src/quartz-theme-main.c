@@ -38,6 +38,7 @@ theme_init (GTypeModule * module)
 G_MODULE_EXPORT void
 theme_exit (void)
 {
+  quartz_style_exit ();
 }
 
 G_MODULE_EXPORT GtkRcStyle *
@@ -49,5 +50,8 @@ theme_create_rc_style (void)
 G_MODULE_EXPORT const gchar *
 g_module_check_init (GModule * module)
 {
+  /* quartz_style_exit() is registered with atexit(). */
+  g_module_make_resident (module);
+
   return gtk_check_version (2, 10, 0);
 }
@@ -0,0 +1,295 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The driver shared by the check and benchmark programs in this
+ * directory. It is a thin layer over GTest: a plain run, like the one
+ * "make check" does, runs every case once, and "-m perf" times the
+ * benchmarks as well, e.g.
+ *
+ *   ./test-cache -m perf -p /cache/bench
+ *
+ * Benchmarks report the time per call as a minimized result, so
+ * gtester-report can compare runs. A benchmark can also be gated on
+ * another one that ran before it in the same run, e.g. a cached path
+ * against the direct one, which holds up on any machine where absolute
+ * times wouldn't.
+ *
+ * With QUARTZ_TEST_COUNTERS set, the hardware counters are read around
+ * the timed calls where perf_event_open() is there to read them, and
+ * each benchmark also reports its instructions per cycle and its cache
+ * and branch misses per call. Elsewhere, or when the kernel refuses,
+ * a message says so and only the time is reported.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib-object.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "driver.h"
+
+/* How long each benchmark runs for in perf mode, in seconds. */
+#define BENCH_TIME 0.5
+
+typedef struct
+{
+  gchar           *path;
+  QuartzBenchFunc  func;
+  gpointer         data;
+  gchar           *baseline;
+  gdouble          max_ratio;
+} Bench;
+
+/* Path -> seconds per call, for the benchmarks that ran so far. */
+static GHashTable *results = NULL;
+
+enum
+{
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_CACHE_MISSES,
+  COUNTER_BRANCH_MISSES,
+  N_COUNTERS
+};
+
+/* The group leader, -1 when the counters aren't read. */
+static gint counters_fd = -1;
+
+#ifdef __linux__
+static gint
+open_counter (guint64 config,
+              gint    group_fd)
+{
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+
+  return syscall (__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void
+open_counters (void)
+{
+#ifdef __linux__
+  static const guint64 configs[N_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+  gint i;
+
+  counters_fd = open_counter (configs[0], -1);
+  for (i = 1; i < N_COUNTERS && counters_fd != -1; i++)
+    {
+      /* Closing the leader would leave the members open, they live as
+       * long as the process anyway.
+       */
+      if (open_counter (configs[i], counters_fd) == -1)
+        {
+          close (counters_fd);
+          counters_fd = -1;
+        }
+    }
+
+  if (counters_fd == -1)
+    g_test_message ("QUARTZ_TEST_COUNTERS: perf_event_open failed, only timing");
+#else
+  g_test_message ("QUARTZ_TEST_COUNTERS: no hardware counters here, only timing");
+#endif
+}
+
+static void
+start_counters (void)
+{
+#ifdef __linux__
+  if (counters_fd == -1)
+    return;
+
+  ioctl (counters_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl (counters_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/* Reads the counters into values, returns FALSE if they weren't read. */
+static gboolean
+stop_counters (guint64 *values)
+{
+#ifdef __linux__
+  /* The number of counters, then their values. */
+  guint64 buffer[1 + N_COUNTERS];
+
+  if (counters_fd == -1)
+    return FALSE;
+
+  ioctl (counters_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  if (read (counters_fd, buffer, sizeof (buffer)) != sizeof (buffer) ||
+      buffer[0] != N_COUNTERS)
+    return FALSE;
+
+  memcpy (values, buffer + 1, sizeof (guint64) * N_COUNTERS);
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static void
+report_counters (const Bench   *bench,
+                 const guint64 *values,
+                 guint          calls)
+{
+  gdouble ipc = 0;
+
+  if (values[COUNTER_CYCLES])
+    ipc = (gdouble) values[COUNTER_INSTRUCTIONS] / values[COUNTER_CYCLES];
+
+  g_test_message ("%s: %.2f instructions per cycle, %.1f cache misses and "
+                  "%.1f branch misses per call", bench->path, ipc,
+                  (gdouble) values[COUNTER_CACHE_MISSES] / calls,
+                  (gdouble) values[COUNTER_BRANCH_MISSES] / calls);
+  g_test_minimized_result ((gdouble) values[COUNTER_INSTRUCTIONS] / calls,
+                           "%s: %.0f instructions per call", bench->path,
+                           (gdouble) values[COUNTER_INSTRUCTIONS] / calls);
+}
+
+static void
+check_gate (const Bench *bench,
+            gdouble      per_call)
+{
+  gdouble *result, *baseline;
+
+  if (!results)
+    results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  result = g_new (gdouble, 1);
+  *result = per_call;
+  g_hash_table_insert (results, g_strdup (bench->path), result);
+
+  if (!bench->baseline)
+    return;
+
+  /* Left out with -p. */
+  baseline = g_hash_table_lookup (results, bench->baseline);
+  if (!baseline)
+    return;
+
+  g_test_message ("%s: %.2f times %s, at most %.2f allowed", bench->path,
+                  per_call / *baseline, bench->baseline, bench->max_ratio);
+  g_assert_cmpfloat (per_call, <=, *baseline * bench->max_ratio);
+}
+
+static void
+run_bench (gconstpointer user_data)
+{
+  const Bench *bench = user_data;
+  guint64 values[N_COUNTERS];
+  GTimer *timer;
+  gdouble elapsed;
+  guint calls = 0;
+
+  /* Also warms up whatever caches the benchmark goes through. */
+  bench->func (bench->data);
+
+  if (!g_test_perf ())
+    return;
+
+  timer = g_timer_new ();
+  start_counters ();
+  do
+    {
+      bench->func (bench->data);
+      calls++;
+    }
+  while ((elapsed = g_timer_elapsed (timer, NULL)) < BENCH_TIME);
+  g_timer_destroy (timer);
+
+  g_test_minimized_result (elapsed / calls, "%s: %.2f us per call, %u calls",
+                           bench->path, elapsed / calls * 1000000, calls);
+
+  if (stop_counters (values))
+    report_counters (bench, values, calls);
+
+  check_gate (bench, elapsed / calls);
+}
+
+void
+quartz_test_init (gint    *argc,
+                  gchar ***argv)
+{
+#if !GLIB_CHECK_VERSION (2, 36, 0)
+  g_type_init ();
+#endif
+  g_test_init (argc, argv, NULL);
+
+  if (g_test_perf () && g_getenv ("QUARTZ_TEST_COUNTERS"))
+    open_counters ();
+}
+
+void
+quartz_test_add_bench (const gchar     *path,
+                       QuartzBenchFunc  func,
+                       gpointer         data)
+{
+  quartz_test_add_bench_gated (path, func, data, NULL, 0);
+}
+
+/* Like quartz_test_add_bench(), but in perf mode the benchmark fails
+ * when a call takes more than max_ratio times as long as one of the
+ * baseline benchmark, which has to be added first.
+ */
+void
+quartz_test_add_bench_gated (const gchar     *path,
+                             QuartzBenchFunc  func,
+                             gpointer         data,
+                             const gchar     *baseline,
+                             gdouble          max_ratio)
+{
+  Bench *bench;
+
+  bench = g_new (Bench, 1);
+  bench->path = g_strdup (path);
+  bench->func = func;
+  bench->data = data;
+  bench->baseline = g_strdup (baseline);
+  bench->max_ratio = max_ratio;
+
+  g_test_add_data_func (path, bench, run_bench);
+}
+
+gint
+quartz_test_run (void)
+{
+  return g_test_run ();
+}
@@ -0,0 +1,43 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef QUARTZ_TEST_DRIVER_H
+#define QUARTZ_TEST_DRIVER_H
+
+#include <glib.h>
+
+typedef void (* QuartzBenchFunc) (gpointer data);
+
+void quartz_test_init            (gint            *argc,
+                                  gchar         ***argv);
+
+void quartz_test_add_bench       (const gchar     *path,
+                                  QuartzBenchFunc  func,
+                                  gpointer         data);
+
+void quartz_test_add_bench_gated (const gchar     *path,
+                                  QuartzBenchFunc  func,
+                                  gpointer         data,
+                                  const gchar     *baseline,
+                                  gdouble          max_ratio);
+
+gint quartz_test_run             (void);
+
+#endif /* QUARTZ_TEST_DRIVER_H */
@@ -0,0 +1,77 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Sets the engine up without going through a theme module, for the
+ * tests that draw through the GtkStyle vfuncs.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+
+#include "quartz-style.h"
+#include "quartz-rc-style.h"
+#include "engine.h"
+
+/* Stands in for the module GTK+ would load the engine from. */
+typedef GTypeModule      TestModule;
+typedef GTypeModuleClass TestModuleClass;
+
+G_DEFINE_TYPE (TestModule, test_module, G_TYPE_TYPE_MODULE)
+
+static gboolean
+test_module_load (GTypeModule *module)
+{
+  return TRUE;
+}
+
+static void
+test_module_unload (GTypeModule *module)
+{
+}
+
+static void
+test_module_class_init (TestModuleClass *klass)
+{
+  klass->load = test_module_load;
+  klass->unload = test_module_unload;
+}
+
+static void
+test_module_init (TestModule *module)
+{
+}
+
+/* Registers the engine types, like theme_init(), and returns a new
+ * style that isn't attached yet. Only call this once.
+ */
+GtkStyle *
+quartz_test_init_engine (void)
+{
+  GTypeModule *module;
+
+  module = g_object_new (test_module_get_type (), NULL);
+  g_type_module_use (module);
+
+  quartz_rc_style_register_type (module);
+  quartz_style_register_type (module);
+  quartz_style_init ();
+
+  return g_object_new (QUARTZ_TYPE_STYLE, NULL);
+}
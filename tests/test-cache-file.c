@@ -0,0 +1,267 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Checks that the cache file gives back what was saved, and that a
+ * damaged file is thrown away instead of being drawn from.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <Carbon/Carbon.h>
+
+#include "quartz-cache.h"
+#include "quartz-cache-file.h"
+#include "driver.h"
+
+#define N_IMAGES 16
+
+static gchar *path = NULL;
+
+static void
+render_fill (CGContextRef  context,
+             const HIRect *rect,
+             gpointer      user_data)
+{
+  CGFloat gray = GPOINTER_TO_INT (user_data) / (CGFloat) N_IMAGES;
+
+  CGContextSetRGBFillColor (context, gray, gray, gray, 1.0);
+  CGContextFillRect (context, *rect);
+}
+
+static void
+init_key (QuartzCacheKey *key,
+          gint            i)
+{
+  HIRect rect;
+
+  rect = CGRectMake (0, 0, 10 + i, 20);
+  quartz_cache_key_init_for_scale (key, QUARTZ_CACHE_PLACARD, 1 + i % 2, &rect);
+}
+
+/* Draws image into a tightly packed bitmap so that images can be
+ * compared no matter where their pixels live.
+ */
+static guchar *
+get_pixels (CGImageRef image)
+{
+  CGColorSpaceRef colorspace;
+  CGContextRef context;
+  gsize width, height;
+  guchar *pixels;
+
+  width = CGImageGetWidth (image);
+  height = CGImageGetHeight (image);
+  pixels = g_malloc0 (width * height * 4);
+
+  colorspace = CGColorSpaceCreateDeviceRGB ();
+  context = CGBitmapContextCreate (pixels, width, height, 8, width * 4, colorspace,
+                                   kCGImageAlphaPremultipliedFirst |
+                                   kCGBitmapByteOrder32Host);
+  CGColorSpaceRelease (colorspace);
+
+  CGContextSetBlendMode (context, kCGBlendModeCopy);
+  CGContextDrawImage (context, CGRectMake (0, 0, width, height), image);
+  CGContextRelease (context);
+
+  return pixels;
+}
+
+/* Fills the cache, writes it to the file and starts over empty. */
+static void
+save_images (void)
+{
+  QuartzCacheKey key;
+  CGImageRef image;
+  gint i;
+
+  g_unlink (path);
+  quartz_cache_clear ();
+
+  quartz_cache_file_init (path);
+  for (i = 0; i < N_IMAGES; i++)
+    {
+      init_key (&key, i);
+      image = quartz_cache_render (&key, render_fill, GINT_TO_POINTER (i));
+      CGImageRelease (image);
+    }
+  quartz_cache_file_shutdown ();
+
+  g_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+  quartz_cache_clear ();
+}
+
+static void
+test_round_trip (void)
+{
+  QuartzCacheKey key;
+  CGImageRef image, expected;
+  guchar *pixels, *expected_pixels;
+  gsize size;
+  gint i;
+
+  save_images ();
+
+  quartz_cache_file_init (path);
+
+  for (i = 0; i < N_IMAGES; i++)
+    {
+      init_key (&key, i);
+
+      image = quartz_cache_lookup (&key);
+      g_assert (image != NULL);
+
+      expected = quartz_cache_render_image (&key, render_fill, GINT_TO_POINTER (i));
+      g_assert_cmpint (CGImageGetWidth (image), ==, CGImageGetWidth (expected));
+      g_assert_cmpint (CGImageGetHeight (image), ==, CGImageGetHeight (expected));
+
+      size = CGImageGetWidth (image) * CGImageGetHeight (image) * 4;
+      pixels = get_pixels (image);
+      expected_pixels = get_pixels (expected);
+      g_assert (memcmp (pixels, expected_pixels, size) == 0);
+
+      g_free (pixels);
+      g_free (expected_pixels);
+      CGImageRelease (expected);
+      CGImageRelease (image);
+    }
+
+  quartz_cache_file_shutdown ();
+  quartz_cache_clear ();
+}
+
+static void
+corrupt_file (goffset offset)
+{
+  gchar *contents;
+  gsize length;
+
+  g_assert (g_file_get_contents (path, &contents, &length, NULL));
+
+  if (offset < 0)
+    offset += length;
+  g_assert_cmpint (offset, <, length);
+
+  contents[offset] ^= 0x5a;
+  g_assert (g_file_set_contents (path, contents, length, NULL));
+
+  g_free (contents);
+}
+
+static void
+assert_rejected (void)
+{
+  quartz_cache_file_init (path);
+  g_assert_cmpuint (quartz_cache_get_resident_bytes (), ==, 0);
+  quartz_cache_file_shutdown ();
+}
+
+static void
+test_reject_bad_magic (void)
+{
+  save_images ();
+  corrupt_file (0);
+  assert_rejected ();
+}
+
+/* As if written on another release or with another appearance. */
+static void
+test_reject_other_system (void)
+{
+  save_images ();
+  corrupt_file (20);
+  assert_rejected ();
+
+  save_images ();
+  corrupt_file (68);
+  assert_rejected ();
+}
+
+static void
+test_reject_bad_record (void)
+{
+  /* Past the 116 byte header, inside the first record's key. */
+  save_images ();
+  corrupt_file (128);
+  assert_rejected ();
+}
+
+static void
+test_reject_bad_pixels (void)
+{
+  save_images ();
+  corrupt_file (-1);
+  assert_rejected ();
+}
+
+static void
+test_reject_truncated (void)
+{
+  gchar *contents;
+  gsize length;
+
+  save_images ();
+
+  g_assert (g_file_get_contents (path, &contents, &length, NULL));
+  g_assert (g_file_set_contents (path, contents, length / 2, NULL));
+  g_free (contents);
+
+  assert_rejected ();
+}
+
+static void
+bench_load (gpointer data)
+{
+  quartz_cache_file_init (path);
+  quartz_cache_file_shutdown ();
+  quartz_cache_clear ();
+}
+
+int
+main (int argc, char **argv)
+{
+  gint fd, result;
+
+  quartz_test_init (&argc, &argv);
+
+  fd = g_file_open_tmp ("test-cache-file-XXXXXX", &path, NULL);
+  g_assert (fd >= 0);
+  close (fd);
+
+  g_test_add_func ("/cache-file/round-trip", test_round_trip);
+
+  /* Loads what the round trip left behind, before it gets damaged. */
+  quartz_test_add_bench ("/cache-file/bench/load", bench_load, NULL);
+
+  g_test_add_func ("/cache-file/reject/magic", test_reject_bad_magic);
+  g_test_add_func ("/cache-file/reject/system", test_reject_other_system);
+  g_test_add_func ("/cache-file/reject/record", test_reject_bad_record);
+  g_test_add_func ("/cache-file/reject/pixels", test_reject_bad_pixels);
+  g_test_add_func ("/cache-file/reject/truncated", test_reject_truncated);
+
+  result = quartz_test_run ();
+
+  g_unlink (path);
+  g_free (path);
+
+  return result;
+}
@@ -0,0 +1,303 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Checks and benchmarks for the render cache. These need CoreGraphics
+ * and HITheme, so they only build for the quartz target.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+
+#include "quartz-cache.h"
+#include "driver.h"
+
+/* Rows of a toggle column that fit on a typical screen. */
+#define VISIBLE_ROWS 60
+#define ROW_HEIGHT   18
+#define CHECK_SIZE   13
+
+static CGContextRef
+create_context (gint width,
+                gint height)
+{
+  CGColorSpaceRef colorspace;
+  CGContextRef context;
+
+  colorspace = CGColorSpaceCreateDeviceRGB ();
+  context = CGBitmapContextCreate (NULL, width, height, 8, 0, colorspace,
+                                   kCGImageAlphaPremultipliedFirst |
+                                   kCGBitmapByteOrder32Host);
+  CGColorSpaceRelease (colorspace);
+
+  /* Flipped, like the contexts GDK hands out. */
+  CGContextTranslateCTM (context, 0, height);
+  CGContextScaleCTM (context, 1.0f, -1.0f);
+
+  return context;
+}
+
+static void
+render_button (CGContextRef  context,
+               const HIRect *rect,
+               gpointer      user_data)
+{
+  HIThemeDrawButton (rect, user_data, context, kHIThemeOrientationNormal, NULL);
+}
+
+static void
+init_check_info (HIThemeButtonDrawInfo *draw_info)
+{
+  draw_info->version = 0;
+  draw_info->kind = kThemeCheckBox;
+  draw_info->state = kThemeStateActive;
+  draw_info->value = kThemeButtonOn;
+  draw_info->adornment = kThemeAdornmentNone;
+}
+
+static void
+test_lookup (void)
+{
+  HIThemeButtonDrawInfo draw_info;
+  QuartzCacheKey key;
+  HIRect rect;
+  CGImageRef image;
+
+  init_check_info (&draw_info);
+  rect = CGRectMake (0, 0, CHECK_SIZE, CHECK_SIZE);
+  quartz_cache_key_init_button (&key, 1, &draw_info, &rect, 0);
+
+  g_assert (quartz_cache_lookup (&key) == NULL);
+
+  image = quartz_cache_render (&key, render_button, &draw_info);
+  g_assert (image != NULL);
+  g_assert_cmpint (CGImageGetWidth (image), ==, CHECK_SIZE + 2 * QUARTZ_CACHE_PADDING);
+  CGImageRelease (image);
+
+  image = quartz_cache_lookup (&key);
+  g_assert (image != NULL);
+  CGImageRelease (image);
+
+  quartz_cache_clear ();
+  g_assert (quartz_cache_lookup (&key) == NULL);
+}
+
+static void
+render_fill (CGContextRef  context,
+             const HIRect *rect,
+             gpointer      user_data)
+{
+  CGContextSetRGBFillColor (context, 0.5, 0.5, 0.5, 1.0);
+  CGContextFillRect (context, *rect);
+}
+
+static CGImageRef
+get_fill (guint width,
+          guint height,
+          guint scale)
+{
+  QuartzCacheKey key;
+  CGImageRef image;
+  HIRect rect;
+
+  rect = CGRectMake (0, 0, width, height);
+  quartz_cache_key_init_for_scale (&key, QUARTZ_CACHE_PLACARD, scale, &rect);
+
+  image = quartz_cache_lookup (&key);
+  if (!image)
+    image = quartz_cache_render (&key, render_fill, NULL);
+
+  return image;
+}
+
+/* Resize steps, at ten a second: three hours of a user dragging
+ * window edges around.
+ */
+#define SOAK_STEPS (3 * 60 * 60 * 10)
+#define SOAK_BUDGET (256 * 1024)
+
+/* Every so often a tall bevel button at a new allocation, bigger than
+ * the whole budget.
+ */
+#define SOAK_HUGE_EVERY 1000
+
+static void
+test_budget_soak (void)
+{
+  CGImageRef held = NULL, image, huge;
+  QuartzCacheKey key;
+  HIRect rect;
+  GRand *rand;
+  gsize resident;
+  gint i;
+
+  quartz_cache_clear ();
+  quartz_cache_set_budget (SOAK_BUDGET);
+
+  rand = g_rand_new_with_seed (42);
+
+  for (i = 0; i < SOAK_STEPS; i++)
+    {
+      /* Mostly sizes seen before, sometimes new ones. */
+      image = get_fill (g_rand_int_range (rand, 1, 64),
+                        g_rand_int_range (rand, 1, 64),
+                        g_rand_int_range (rand, 1, 3));
+      g_assert (image != NULL);
+
+      g_assert_cmpuint (quartz_cache_get_resident_bytes (), <=, SOAK_BUDGET);
+
+      if (i % SOAK_HUGE_EVERY == 0)
+        {
+          rect = CGRectMake (0, 0, 300, 200 + i / SOAK_HUGE_EVERY);
+          quartz_cache_key_init_for_scale (&key, QUARTZ_CACHE_BUTTON, 2, &rect);
+
+          /* Drawn straight from the returned image, without pushing
+           * anything else out.
+           */
+          resident = quartz_cache_get_resident_bytes ();
+          huge = quartz_cache_render (&key, render_fill, NULL);
+          g_assert (huge != NULL);
+          g_assert_cmpuint (CGImageGetBytesPerRow (huge) * CGImageGetHeight (huge), >, SOAK_BUDGET);
+          g_assert_cmpuint (quartz_cache_get_resident_bytes (), ==, resident);
+          g_assert (!quartz_cache_contains (&key));
+          CGImageRelease (huge);
+        }
+
+      /* Like the slider holding on to its track while it renders the
+       * knob: whatever gets evicted meanwhile, the image stays usable.
+       */
+      if (held)
+        {
+          g_assert_cmpint (CGImageGetWidth (held), >, 0);
+          CGImageRelease (held);
+        }
+      held = image;
+    }
+
+  CGImageRelease (held);
+  g_rand_free (rand);
+
+  g_assert_cmpuint (quartz_cache_get_evictions (), >, 0);
+}
+
+static void
+test_held_image_outlives_entry (void)
+{
+  CGImageRef image, other;
+  gint i;
+
+  quartz_cache_clear ();
+  quartz_cache_set_budget (128 * 1024);
+
+  image = get_fill (40, 30, 2);
+
+  /* About 30 KB each, more than the budget all together. */
+  for (i = 0; i < 8; i++)
+    {
+      other = get_fill (40, 31 + i, 2);
+      CGImageRelease (other);
+    }
+
+  g_assert_cmpint (CFGetRetainCount (image), ==, 1);
+  g_assert_cmpint (CGImageGetWidth (image), ==, (40 + 2 * QUARTZ_CACHE_PADDING) * 2);
+  CGImageRelease (image);
+}
+
+static void
+test_new_generation (void)
+{
+  CGImageRef image;
+
+  quartz_cache_clear ();
+  quartz_cache_set_budget (SOAK_BUDGET);
+
+  image = get_fill (20, 20, 1);
+  CGImageRelease (image);
+  g_assert_cmpuint (quartz_cache_get_resident_bytes (), >, 0);
+
+  /* Stale images go right away instead of taking up the budget. */
+  quartz_cache_new_generation ();
+  g_assert_cmpuint (quartz_cache_get_resident_bytes (), ==, 0);
+}
+
+/* A toggle column being scrolled: the same check box drawn once per
+ * visible row, straight through HITheme or blitted from the cache.
+ */
+static void
+bench_cellcheck_direct (gpointer data)
+{
+  CGContextRef context = data;
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect;
+  gint i;
+
+  init_check_info (&draw_info);
+
+  for (i = 0; i < VISIBLE_ROWS; i++)
+    {
+      rect = CGRectMake (2, i * ROW_HEIGHT + 2, CHECK_SIZE, CHECK_SIZE);
+      HIThemeDrawButton (&rect, &draw_info, context, kHIThemeOrientationNormal, NULL);
+    }
+}
+
+static void
+bench_cellcheck_cached (gpointer data)
+{
+  CGContextRef context = data;
+  HIThemeButtonDrawInfo draw_info;
+  QuartzCacheKey key;
+  CGImageRef image;
+  HIRect rect;
+  gint i;
+
+  init_check_info (&draw_info);
+
+  for (i = 0; i < VISIBLE_ROWS; i++)
+    {
+      rect = CGRectMake (2, i * ROW_HEIGHT + 2, CHECK_SIZE, CHECK_SIZE);
+      quartz_cache_key_init_button (&key, 1, &draw_info, &rect, 0);
+
+      image = quartz_cache_lookup (&key);
+      if (!image)
+        image = quartz_cache_render (&key, render_button, &draw_info);
+
+      quartz_cache_draw_image (context, image, &rect);
+      CGImageRelease (image);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  CGContextRef context;
+
+  quartz_test_init (&argc, &argv);
+
+  context = create_context (CHECK_SIZE + 4, VISIBLE_ROWS * ROW_HEIGHT);
+
+  g_test_add_func ("/cache/lookup", test_lookup);
+  g_test_add_func ("/cache/budget-soak", test_budget_soak);
+  g_test_add_func ("/cache/held-image", test_held_image_outlives_entry);
+  g_test_add_func ("/cache/new-generation", test_new_generation);
+  quartz_test_add_bench ("/cache/bench/cellcheck-direct", bench_cellcheck_direct, context);
+  quartz_test_add_bench ("/cache/bench/cellcheck-cached", bench_cellcheck_cached, context);
+
+  return quartz_test_run ();
+}
@@ -0,0 +1,393 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The cairo primitives only need cairo and GLib, so these run
+ * anywhere. The benchmarks measure fill rate off OS X.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <cairo.h>
+
+#include "quartz-cairo.h"
+#include "driver.h"
+
+/* Lion's active statusbar, from nsNativeThemeColors.h. */
+static const QuartzCairoStatusbarColors statusbar_colors = {
+  0x7A / 255.0, 0xCF / 255.0, 0xC9 / 255.0, 0xA7 / 255.0
+};
+
+#define STATUSBAR_HEIGHT 22
+
+/* Made up, but with every part a different grey so they can be told
+ * apart.
+ */
+static const QuartzCairoBezelColors bezel_colors = { 0.4, 0.9, 0.7 };
+static const QuartzCairoTrackColors track_colors = { 0.6, 0.9, 0.5, 0.3 };
+static const QuartzCairoFrameColors frame_colors = { 0.3, 0.5, 0.8 };
+
+#define MENU_GREY  0.95
+#define MENU_ALPHA 0.9
+
+/* A typical laptop screen. */
+#define SCREEN_WIDTH  1440
+#define SCREEN_HEIGHT 900
+
+static cairo_surface_t *
+create_surface (gint width,
+                gint height)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+
+  cr = cairo_create (surface);
+  cairo_set_source_rgb (cr, 0, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+static void
+assert_grey (cairo_surface_t *surface,
+             gint             x,
+             gint             y,
+             gdouble          expected)
+{
+  const guint32 *row;
+  gint grey;
+
+  cairo_surface_flush (surface);
+
+  row = (const guint32 *) (cairo_image_surface_get_data (surface) +
+                           y * cairo_image_surface_get_stride (surface));
+  grey = (row[x] >> 8) & 0xff;
+
+  g_assert_cmpint (abs (grey - (gint) (expected * 255 + 0.5)), <=, 2);
+}
+
+static void
+test_statusbar (void)
+{
+  const QuartzCairoStatusbarColors *colors = &statusbar_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (100, STATUSBAR_HEIGHT);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_statusbar (cr, colors, 0, 0, 100, STATUSBAR_HEIGHT);
+  cairo_destroy (cr);
+
+  /* The border lines cover half of the first two rows, over black. */
+  assert_grey (surface, 50, 0, colors->first_border / 2);
+  assert_grey (surface, 50, 1, colors->second_border / 2);
+
+  /* Pixels are sampled at their centers. */
+  assert_grey (surface, 50, 2, colors->gradient_start +
+               (colors->gradient_end - colors->gradient_start) * 0.5 / (STATUSBAR_HEIGHT - 2));
+  assert_grey (surface, 50, STATUSBAR_HEIGHT - 1, colors->gradient_end +
+               (colors->gradient_start - colors->gradient_end) * 0.5 / (STATUSBAR_HEIGHT - 2));
+
+  cairo_surface_destroy (surface);
+}
+
+/* Where a vertical gradient over height pixels is at row y. */
+static gdouble
+gradient_at (gdouble start,
+             gdouble end,
+             gint    y,
+             gint    height)
+{
+  return start + (end - start) * (y + 0.5) / height;
+}
+
+static void
+test_bezel (void)
+{
+  const QuartzCairoBezelColors *colors = &bezel_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (60, 24);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_bezel (cr, colors, 4, 0, 0, 60, 24);
+  cairo_destroy (cr);
+
+  assert_grey (surface, 30, 0, colors->border);
+  assert_grey (surface, 0, 12, colors->border);
+  assert_grey (surface, 30, 23, colors->border);
+  assert_grey (surface, 30, 12, gradient_at (colors->fill_start, colors->fill_end, 12, 24));
+
+  /* Outside of the rounded corner. */
+  assert_grey (surface, 0, 0, 0);
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+test_placard (void)
+{
+  const QuartzCairoBezelColors *colors = &bezel_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (60, 20);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_placard (cr, colors, 0, 0, 60, 20);
+  cairo_destroy (cr);
+
+  /* Square corners. */
+  assert_grey (surface, 0, 0, colors->border);
+  assert_grey (surface, 59, 19, colors->border);
+  assert_grey (surface, 30, 10, gradient_at (colors->fill_start, colors->fill_end, 10, 20));
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+test_tab (void)
+{
+  const QuartzCairoBezelColors *colors = &bezel_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (60, 20);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_tab (cr, colors, 4, 0, 0, 60, 20);
+  cairo_destroy (cr);
+
+  assert_grey (surface, 0, 0, 0);
+  assert_grey (surface, 30, 0, colors->border);
+  assert_grey (surface, 0, 19, colors->border);
+
+  /* No border where the tab joins the page. */
+  assert_grey (surface, 30, 19, gradient_at (colors->fill_start, colors->fill_end, 19, 20));
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+test_track (void)
+{
+  const QuartzCairoTrackColors *colors = &track_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (100, 15);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_track (cr, colors, TRUE, 40, 30, 0, 0, 100, 15);
+  cairo_destroy (cr);
+
+  assert_grey (surface, 20, 0, colors->border);
+  assert_grey (surface, 20, 7, colors->trough);
+
+  /* The thumb covers 42 to 72. */
+  assert_grey (surface, 57, 7, gradient_at (colors->thumb_start, colors->thumb_end, 7, 15));
+  assert_grey (surface, 80, 7, colors->trough);
+
+  cairo_surface_destroy (surface);
+
+  /* Vertical ones are shaded from left to right. */
+  surface = create_surface (15, 100);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_track (cr, colors, FALSE, 40, 30, 0, 0, 15, 100);
+  cairo_destroy (cr);
+
+  assert_grey (surface, 7, 20, colors->trough);
+  assert_grey (surface, 7, 57, gradient_at (colors->thumb_start, colors->thumb_end, 7, 15));
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+test_frame (void)
+{
+  const QuartzCairoFrameColors *colors = &frame_colors;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (40, 30);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_frame (cr, colors, 0, 0, 40, 30);
+  cairo_destroy (cr);
+
+  assert_grey (surface, 20, 0, colors->top);
+  assert_grey (surface, 0, 15, colors->sides);
+  assert_grey (surface, 39, 15, colors->sides);
+  assert_grey (surface, 20, 29, colors->bottom);
+  assert_grey (surface, 20, 15, 0);
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+test_menu (void)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_surface (40, 30);
+
+  cr = cairo_create (surface);
+  quartz_cairo_draw_menu (cr, MENU_GREY, MENU_ALPHA, 0, 0, 40, 30);
+  cairo_destroy (cr);
+
+  /* Blended over black. */
+  assert_grey (surface, 0, 0, MENU_GREY * MENU_ALPHA);
+  assert_grey (surface, 20, 15, MENU_GREY * MENU_ALPHA);
+  assert_grey (surface, 0, 29, 0);
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+bench_statusbar (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_statusbar (cr, &statusbar_colors, 0, SCREEN_HEIGHT - STATUSBAR_HEIGHT,
+                               SCREEN_WIDTH, STATUSBAR_HEIGHT);
+  cairo_destroy (cr);
+}
+
+/* The unified window background, for a window covering the screen. */
+static void
+bench_window_gradient (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_gradient (cr, statusbar_colors.gradient_start,
+                              statusbar_colors.gradient_end,
+                              0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+  cairo_destroy (cr);
+}
+
+/* A row of dialog buttons. */
+static void
+bench_bezel (gpointer data)
+{
+  cairo_t *cr;
+  gint i;
+
+  cr = cairo_create (data);
+  for (i = 0; i < 4; i++)
+    quartz_cairo_draw_bezel (cr, &bezel_colors, 4, 20 + i * 90, 20, 85, 22);
+  cairo_destroy (cr);
+}
+
+static void
+bench_placard (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_placard (cr, &bezel_colors, 0, 0, SCREEN_WIDTH, 24);
+  cairo_destroy (cr);
+}
+
+static void
+bench_tab (gpointer data)
+{
+  cairo_t *cr;
+  gint i;
+
+  cr = cairo_create (data);
+  for (i = 0; i < 4; i++)
+    quartz_cairo_draw_tab (cr, &bezel_colors, 4, 20 + i * 100, 60, 100, 22);
+  cairo_destroy (cr);
+}
+
+/* The vertical scrollbar of a window covering the screen. */
+static void
+bench_track (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_track (cr, &track_colors, FALSE, 200, 150,
+                           SCREEN_WIDTH - 15, 0, 15, SCREEN_HEIGHT);
+  cairo_destroy (cr);
+}
+
+static void
+bench_frame (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_frame (cr, &frame_colors, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+  cairo_destroy (cr);
+}
+
+static void
+bench_menu (gpointer data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data);
+  quartz_cairo_draw_menu (cr, MENU_GREY, MENU_ALPHA, 100, 22, 240, 400);
+  cairo_destroy (cr);
+}
+
+int
+main (int argc, char **argv)
+{
+  cairo_surface_t *surface;
+  gint result;
+
+  quartz_test_init (&argc, &argv);
+
+  surface = create_surface (SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  g_test_add_func ("/cairo/statusbar", test_statusbar);
+  g_test_add_func ("/cairo/bezel", test_bezel);
+  g_test_add_func ("/cairo/placard", test_placard);
+  g_test_add_func ("/cairo/tab", test_tab);
+  g_test_add_func ("/cairo/track", test_track);
+  g_test_add_func ("/cairo/frame", test_frame);
+  g_test_add_func ("/cairo/menu", test_menu);
+
+  quartz_test_add_bench ("/cairo/bench/statusbar", bench_statusbar, surface);
+  quartz_test_add_bench ("/cairo/bench/window-gradient", bench_window_gradient, surface);
+  quartz_test_add_bench ("/cairo/bench/bezel", bench_bezel, surface);
+  quartz_test_add_bench ("/cairo/bench/placard", bench_placard, surface);
+  quartz_test_add_bench ("/cairo/bench/tab", bench_tab, surface);
+  quartz_test_add_bench ("/cairo/bench/track", bench_track, surface);
+  quartz_test_add_bench ("/cairo/bench/frame", bench_frame, surface);
+  quartz_test_add_bench ("/cairo/bench/menu", bench_menu, surface);
+
+  result = quartz_test_run ();
+
+  cairo_surface_destroy (surface);
+
+  return result;
+}
@@ -0,0 +1,150 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The thumb geometry doesn't need Carbon, so these run anywhere. */
+
+#include <config.h>
+#include <math.h>
+#include <glib.h>
+
+#include "quartz-geometry.h"
+#include "driver.h"
+
+static void
+assert_rect (const QuartzRect *rect,
+             gdouble           x,
+             gdouble           y,
+             gdouble           width,
+             gdouble           height)
+{
+  g_assert_cmpfloat (fabs (rect->x - x), <, 0.001);
+  g_assert_cmpfloat (fabs (rect->y - y), <, 0.001);
+  g_assert_cmpfloat (fabs (rect->width - width), <, 0.001);
+  g_assert_cmpfloat (fabs (rect->height - height), <, 0.001);
+}
+
+static void
+test_union (void)
+{
+  QuartzRect a = { 0, 0, 10, 10 }, b = { 20, 5, 10, 10 }, empty = { 50, 50, 0, 0 };
+  QuartzRect dest;
+
+  quartz_rect_union (&a, &b, &dest);
+  assert_rect (&dest, 0, 0, 30, 15);
+
+  /* Empty rects don't stretch the union to wherever they are. */
+  quartz_rect_union (&a, &empty, &dest);
+  assert_rect (&dest, 0, 0, 10, 10);
+  quartz_rect_union (&empty, &b, &dest);
+  assert_rect (&dest, 20, 5, 10, 10);
+}
+
+static void
+test_scrollbar_thumb (void)
+{
+  QuartzRect drag = { 0, 10, 15, 200 };
+  QuartzRect thumb;
+
+  /* A page of a quarter of the range gives a quarter-length thumb. */
+  quartz_track_thumb_rect (&drag, FALSE, 0, 100, 25, 0, 16, &thumb);
+  assert_rect (&thumb, 0, 10, 15, 50);
+
+  quartz_track_thumb_rect (&drag, FALSE, 0, 100, 25, 75, 16, &thumb);
+  assert_rect (&thumb, 0, 160, 15, 50);
+
+  quartz_track_thumb_rect (&drag, FALSE, 0, 100, 25, 37.5, 16, &thumb);
+  assert_rect (&thumb, 0, 85, 15, 50);
+
+  /* Values outside of the range are clamped. */
+  quartz_track_thumb_rect (&drag, FALSE, 0, 100, 25, 1000, 16, &thumb);
+  assert_rect (&thumb, 0, 160, 15, 50);
+  quartz_track_thumb_rect (&drag, FALSE, 0, 100, 25, -5, 16, &thumb);
+  assert_rect (&thumb, 0, 10, 15, 50);
+}
+
+static void
+test_minimum_length (void)
+{
+  QuartzRect drag = { 5, 0, 100, 15 };
+  QuartzRect thumb;
+
+  /* A huge range would give a sliver of a thumb. */
+  quartz_track_thumb_rect (&drag, TRUE, 0, 100000, 10, 0, 20, &thumb);
+  assert_rect (&thumb, 5, 0, 20, 15);
+
+  quartz_track_thumb_rect (&drag, TRUE, 0, 100000, 10, 100000, 20, &thumb);
+  assert_rect (&thumb, 85, 0, 20, 15);
+
+  /* But never longer than the track. */
+  quartz_track_thumb_rect (&drag, TRUE, 0, 100, 10, 0, 200, &thumb);
+  assert_rect (&thumb, 5, 0, 100, 15);
+
+  /* Everything visible: the thumb fills the track. */
+  quartz_track_thumb_rect (&drag, TRUE, 0, 100, 100, 0, 20, &thumb);
+  assert_rect (&thumb, 5, 0, 100, 15);
+}
+
+static void
+test_slider_knob (void)
+{
+  QuartzRect drag = { 0, 0, 120, 20 };
+  QuartzRect thumb;
+
+  /* Scales have no page, the knob is min_length and moves with the
+   * value, fractional ranges included.
+   */
+  quartz_track_thumb_rect (&drag, TRUE, 0, 1, 0, 0.5, 20, &thumb);
+  assert_rect (&thumb, 50, 0, 20, 20);
+
+  quartz_track_thumb_rect (&drag, TRUE, 0, 1, 0, 0.25, 20, &thumb);
+  assert_rect (&thumb, 25, 0, 20, 20);
+
+  quartz_track_thumb_rect (&drag, TRUE, -10, 10, 0, 10, 20, &thumb);
+  assert_rect (&thumb, 100, 0, 20, 20);
+
+  /* An empty range keeps the knob at the start. */
+  quartz_track_thumb_rect (&drag, TRUE, 5, 5, 0, 5, 20, &thumb);
+  assert_rect (&thumb, 0, 0, 20, 20);
+}
+
+static void
+bench_thumb_rect (gpointer data)
+{
+  QuartzRect drag = { 0, 0, 15, 400 };
+  QuartzRect thumb;
+  gint i;
+
+  for (i = 0; i < 1000; i++)
+    quartz_track_thumb_rect (&drag, FALSE, 0, 100000, 40, i * 100, 16, &thumb);
+}
+
+int
+main (int argc, char **argv)
+{
+  quartz_test_init (&argc, &argv);
+
+  g_test_add_func ("/geometry/union", test_union);
+  g_test_add_func ("/geometry/scrollbar-thumb", test_scrollbar_thumb);
+  g_test_add_func ("/geometry/minimum-length", test_minimum_length);
+  g_test_add_func ("/geometry/slider-knob", test_slider_knob);
+  quartz_test_add_bench ("/geometry/bench/thumb-rect", bench_thumb_rect, NULL);
+
+  return quartz_test_run ();
+}
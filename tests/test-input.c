@@ -0,0 +1,125 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Presses a button in a real window with synthesized mouse and key
+ * events, and checks the input latency the engine measures from each
+ * press to the end of the draw call that shows it pressed. With -m
+ * perf the median and 99th percentile are reported.
+ */
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include <gdk/gdkkeysyms.h>
+
+#include "quartz-stats.h"
+#include "driver.h"
+#include "engine.h"
+
+#define N_PRESSES 20
+
+/* Generous, a loaded build machine shouldn't make this fail. */
+#define MAX_P99 250.0
+
+static GtkStyle *style = NULL;
+
+#if GTK_CHECK_VERSION (2, 14, 0)
+static void
+flush (void)
+{
+  gdk_window_process_all_updates ();
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+}
+
+static void
+test_input_latency (void)
+{
+  GtkWidget *window, *button;
+  GdkWindow *target;
+  gint x, y;
+  gdouble p50, p99;
+  guint n_presses;
+  gint i;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  button = gtk_button_new_with_label ("Press");
+  gtk_widget_set_style (button, style);
+  gtk_container_add (GTK_CONTAINER (window), button);
+  gtk_widget_show_all (window);
+  flush ();
+
+  /* A button has no window of its own, it draws on the toplevel's. */
+  target = gtk_widget_get_window (button);
+  x = button->allocation.x + button->allocation.width / 2;
+  y = button->allocation.y + button->allocation.height / 2;
+
+  for (i = 0; i < N_PRESSES; i++)
+    {
+      gdk_test_simulate_button (target, x, y, 1, 0, GDK_BUTTON_PRESS);
+      flush ();
+      gdk_test_simulate_button (target, x, y, 1, 0, GDK_BUTTON_RELEASE);
+      flush ();
+    }
+
+  gtk_widget_grab_focus (button);
+
+  for (i = 0; i < N_PRESSES; i++)
+    {
+      gdk_test_simulate_key (target, -1, -1, GDK_space, 0, GDK_KEY_PRESS);
+      flush ();
+      gdk_test_simulate_key (target, -1, -1, GDK_space, 0, GDK_KEY_RELEASE);
+      flush ();
+    }
+
+  n_presses = quartz_stats_get_input_latency (&p50, &p99);
+  g_test_message ("%u presses drawn, p50 %.1f ms, p99 %.1f ms", n_presses, p50, p99);
+
+  /* Every click is drawn pressed, a key press may not be. */
+  g_assert_cmpuint (n_presses, >=, N_PRESSES);
+  g_assert_cmpfloat (p50, <=, p99);
+  g_assert_cmpfloat (p99, <, MAX_P99);
+
+  if (g_test_perf ())
+    {
+      g_test_minimized_result (p50 / 1000, "input latency p50: %.2f ms", p50);
+      g_test_minimized_result (p99 / 1000, "input latency p99: %.2f ms", p99);
+    }
+
+  gtk_widget_destroy (window);
+}
+#endif
+
+int
+main (int argc, char **argv)
+{
+  /* The latency is only measured with the stats on. */
+  g_setenv ("QUARTZ_STATS", "1", TRUE);
+
+  quartz_test_init (&argc, &argv);
+  gtk_init (&argc, &argv);
+
+  style = quartz_test_init_engine ();
+
+#if GTK_CHECK_VERSION (2, 14, 0)
+  g_test_add_func ("/input/latency", test_input_latency);
+#endif
+
+  return quartz_test_run ();
+}
@@ -0,0 +1,527 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Draws each primitive that goes through the render cache once with
+ * the cache turned off and once from the cache, and checks that the
+ * two look the same. With -m perf both ways are timed as well.
+ *
+ * The window gradient and placard only use the cache during a live
+ * resize, which never happens for a pixmap, so they aren't covered.
+ *
+ * The cold start cases check that what a first dialog draws has been
+ * rendered by the prerender threads, and time a first frame drawn into
+ * an empty cache against prerendering.
+ *
+ * Once the caches are warm, drawing everything again must not leave
+ * any malloc block behind, autoreleased objects included.
+ *
+ * With -m perf a scale being dragged end to end is redrawn at each
+ * step, with the cache on and off, and the frames per second of both
+ * are reported. Compositing the knob over the cached track has to keep
+ * up with drawing the whole slider.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc/malloc.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+#include <AppKit/AppKit.h>
+
+#include "quartz-cache.h"
+#include "quartz-draw.h"
+#include "quartz-metrics.h"
+#include "quartz-prerender.h"
+#include "driver.h"
+
+#define WIDTH  240
+#define HEIGHT 40
+
+/* How far a channel may be off before a pixel counts as different. */
+#define TOLERANCE 16
+
+/* Drawing from the cache has to be at least as fast as drawing
+ * directly, or the cache isn't worth its memory.
+ */
+#define CACHED_MAX_RATIO 1.0
+
+/* Positions the knob goes through in one drag, and how many drags. */
+#define DRAG_STEPS 200
+#define N_DRAGS    10
+
+typedef struct
+{
+  const gchar *name;
+  void       (*draw) (GdkWindow *window);
+
+  /* Percentage of the pixels allowed to differ. Stretched and
+   * repositioned images can't match the direct rendering exactly.
+   */
+  gint         max_mismatch;
+} Primitive;
+
+typedef struct
+{
+  const Primitive *primitive;
+  gboolean         cached;
+} Bench;
+
+static GdkPixmap *pixmap = NULL;
+
+static void
+init_button (HIThemeButtonDrawInfo *draw_info,
+             ThemeButtonKind        kind,
+             ThemeButtonValue       value)
+{
+  draw_info->version = 0;
+  draw_info->kind = kind;
+  draw_info->state = kThemeStateActive;
+  draw_info->value = value;
+  draw_info->adornment = kThemeAdornmentNone;
+}
+
+static void
+draw_push_button (GdkWindow *window)
+{
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect = CGRectMake (10, 10, 80, 20);
+
+  init_button (&draw_info, kThemePushButton, kThemeButtonOff);
+  quartz_draw_cached_button (window, NULL, &draw_info, &rect);
+}
+
+static void
+draw_check_box (GdkWindow *window)
+{
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect = CGRectMake (10, 10, 13, 13);
+
+  init_button (&draw_info, kThemeCheckBox, kThemeButtonOn);
+  quartz_draw_cached_button (window, NULL, &draw_info, &rect);
+}
+
+static void
+draw_radio_button (GdkWindow *window)
+{
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect = CGRectMake (10, 10, 13, 13);
+
+  init_button (&draw_info, kThemeRadioButton, kThemeButtonOn);
+  quartz_draw_cached_button (window, NULL, &draw_info, &rect);
+}
+
+static void
+draw_list_header (GdkWindow *window)
+{
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect = CGRectMake (0, 10, 200, 17);
+
+  init_button (&draw_info, kThemeListHeaderButton, kThemeButtonOff);
+  quartz_draw_list_header (window, NULL, &draw_info, &rect);
+}
+
+static void
+init_track (HIThemeTrackDrawInfo *draw_info,
+            ThemeTrackKind        kind,
+            const HIRect         *rect)
+{
+  memset (draw_info, 0, sizeof (HIThemeTrackDrawInfo));
+
+  draw_info->kind = kind;
+  draw_info->enableState = kThemeTrackActive;
+  draw_info->bounds = *rect;
+  draw_info->attributes = kThemeTrackShowThumb | kThemeTrackThumbRgnIsNotGhost |
+                          kThemeTrackHorizontal;
+}
+
+static void
+draw_scrollbar (GdkWindow *window)
+{
+  HIThemeTrackDrawInfo draw_info;
+  HIRect rect = CGRectMake (0, 12, WIDTH, 15);
+
+  init_track (&draw_info, kThemeScrollBarMedium, &rect);
+  draw_info.min = 0;
+  draw_info.max = 80;
+  draw_info.value = 30;
+  draw_info.trackInfo.scrollbar.viewsize = 20;
+  quartz_draw_track (window, NULL, &draw_info);
+}
+
+static void
+draw_slider (GdkWindow *window)
+{
+  HIThemeTrackDrawInfo draw_info;
+  HIRect rect = CGRectMake (0, 10, WIDTH, 21);
+
+  init_track (&draw_info, kThemeSlider, &rect);
+  draw_info.min = 0;
+  draw_info.max = G_MAXINT;
+  draw_info.value = G_MAXINT / 3;
+  draw_info.trackInfo.slider.thumbDir = kThemeThumbPlain;
+  quartz_draw_slider (window, NULL, &draw_info);
+}
+
+/* One frame of a drag, with the knob at step of DRAG_STEPS. */
+static void
+draw_slider_at (GdkWindow *window,
+                gint       step)
+{
+  HIThemeTrackDrawInfo draw_info;
+  HIRect rect = CGRectMake (0, 10, WIDTH, 21);
+
+  init_track (&draw_info, kThemeSlider, &rect);
+  draw_info.min = 0;
+  draw_info.max = DRAG_STEPS;
+  draw_info.value = step;
+  draw_info.trackInfo.slider.thumbDir = kThemeThumbPlain;
+  quartz_draw_slider (window, NULL, &draw_info);
+}
+
+static void
+draw_arrow (GdkWindow *window)
+{
+  HIThemePopupArrowDrawInfo draw_info;
+  HIRect rect = CGRectMake (10, 10, 10, 10);
+
+  draw_info.version = 0;
+  draw_info.state = kThemeStateActive;
+  draw_info.orientation = kThemeArrowDown;
+  draw_info.size = kThemeArrow9pt;
+  quartz_draw_popup_arrow (window, NULL, &draw_info, &rect);
+}
+
+/* Push buttons the size of a button box child with the default focus
+ * line width, check boxes and arrows, in the states a first dialog
+ * shows them in.
+ */
+static void
+draw_first_dialog (GdkWindow *window)
+{
+  static const ThemeDrawState states[] = {
+    kThemeStateActive, kThemeStatePressed, kThemeStateInactive
+  };
+  HIThemeButtonDrawInfo draw_info;
+  HIRect rect;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    {
+      init_button (&draw_info, kThemePushButton, kThemeButtonOff);
+      draw_info.state = states[i];
+      quartz_metrics_button_rect (&draw_info, 1, 1, 83, 25, &rect);
+      quartz_draw_cached_button (window, NULL, &draw_info, &rect);
+
+      init_button (&draw_info, kThemeCheckBox, kThemeButtonOn);
+      draw_info.state = states[i];
+      rect = CGRectMake (100, 10, 13, 13);
+      quartz_draw_cached_button (window, NULL, &draw_info, &rect);
+    }
+
+  draw_arrow (window);
+}
+
+static const Primitive primitives[] = {
+  { "push-button",  draw_push_button,  1 },
+  { "check-box",    draw_check_box,    1 },
+  { "radio-button", draw_radio_button, 1 },
+  { "list-header",  draw_list_header,  5 },
+  { "scrollbar",    draw_scrollbar,    1 },
+  { "slider",       draw_slider,       5 },
+  { "arrow",        draw_arrow,        1 }
+};
+
+static void
+clear (void)
+{
+  cairo_t *cr;
+
+  cr = gdk_cairo_create (pixmap);
+  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+}
+
+static GdkPixbuf *
+render (const Primitive *primitive,
+        gboolean         cached)
+{
+  clear ();
+
+  quartz_cache_set_disabled (!cached);
+  primitive->draw (pixmap);
+
+  return gdk_pixbuf_get_from_drawable (NULL, pixmap, NULL, 0, 0, 0, 0, WIDTH, HEIGHT);
+}
+
+static gint
+count_mismatches (GdkPixbuf *a,
+                  GdkPixbuf *b)
+{
+  const guchar *pa, *pb;
+  gint x, y, c, n_channels;
+  gint mismatches = 0;
+
+  n_channels = gdk_pixbuf_get_n_channels (a);
+
+  for (y = 0; y < HEIGHT; y++)
+    {
+      pa = gdk_pixbuf_get_pixels (a) + y * gdk_pixbuf_get_rowstride (a);
+      pb = gdk_pixbuf_get_pixels (b) + y * gdk_pixbuf_get_rowstride (b);
+
+      for (x = 0; x < WIDTH; x++)
+        {
+          for (c = 0; c < n_channels; c++)
+            if (abs (pa[c] - pb[c]) > TOLERANCE)
+              break;
+
+          if (c < n_channels)
+            mismatches++;
+
+          pa += n_channels;
+          pb += n_channels;
+        }
+    }
+
+  return mismatches;
+}
+
+static void
+test_primitive (gconstpointer data)
+{
+  const Primitive *primitive = data;
+  GdkPixbuf *direct, *cached;
+  gint mismatches;
+
+  direct = render (primitive, FALSE);
+
+  /* Once to fill the cache, then once more to draw from it. */
+  quartz_cache_clear ();
+  g_object_unref (render (primitive, TRUE));
+  cached = render (primitive, TRUE);
+
+  mismatches = count_mismatches (direct, cached);
+  g_test_message ("%s: %d of %d pixels differ", primitive->name,
+                  mismatches, WIDTH * HEIGHT);
+  g_assert_cmpint (mismatches * 100, <=, primitive->max_mismatch * WIDTH * HEIGHT);
+
+  g_object_unref (direct);
+  g_object_unref (cached);
+}
+
+static void
+draw_all (void)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (primitives); i++)
+    primitives[i].draw (pixmap);
+
+  draw_first_dialog (pixmap);
+}
+
+static void
+test_no_allocations (void)
+{
+  NSAutoreleasePool *pool;
+  malloc_statistics_t before, after;
+
+  quartz_cache_set_disabled (FALSE);
+
+  /* Twice, so that the second round already finds its predictions
+   * queued.
+   */
+  pool = [[NSAutoreleasePool alloc] init];
+  draw_all ();
+  draw_all ();
+  [pool release];
+
+  /* The pool is only drained once the blocks are counted. */
+  pool = [[NSAutoreleasePool alloc] init];
+  malloc_zone_statistics (NULL, &before);
+  draw_all ();
+  malloc_zone_statistics (NULL, &after);
+  [pool release];
+
+  g_test_message ("%d blocks before, %d after",
+                  (gint) before.blocks_in_use, (gint) after.blocks_in_use);
+  g_assert_cmpuint (after.blocks_in_use, ==, before.blocks_in_use);
+}
+
+static void
+prerender (void)
+{
+  quartz_prerender_start_for_scale (2, 1);
+  quartz_prerender_wait ();
+}
+
+static void
+test_cold_start (void)
+{
+  gsize resident;
+
+  quartz_cache_set_disabled (FALSE);
+  quartz_cache_clear ();
+
+  prerender ();
+  resident = quartz_cache_get_resident_bytes ();
+  g_assert_cmpuint (resident, >, 0);
+
+  /* Nothing new gets rendered. */
+  clear ();
+  draw_first_dialog (pixmap);
+  g_assert_cmpuint (quartz_cache_get_resident_bytes (), ==, resident);
+}
+
+static void
+bench_cold_start_empty (gpointer data)
+{
+  quartz_cache_set_disabled (FALSE);
+  quartz_cache_clear ();
+  draw_first_dialog (pixmap);
+}
+
+static void
+bench_cold_start_prerender (gpointer data)
+{
+  quartz_cache_set_disabled (FALSE);
+  quartz_cache_clear ();
+  prerender ();
+}
+
+/* Frames per second over N_DRAGS drags from one end to the other. */
+static gdouble
+drag_slider (gboolean cached)
+{
+  GTimer *timer;
+  gdouble elapsed;
+  gint i, step;
+
+  quartz_cache_set_disabled (!cached);
+
+  /* Warms up the track and the knob. */
+  draw_slider_at (pixmap, 0);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_DRAGS; i++)
+    for (step = 0; step <= DRAG_STEPS; step++)
+      {
+        draw_slider_at (pixmap, step);
+        gdk_flush ();
+      }
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return N_DRAGS * (DRAG_STEPS + 1) / elapsed;
+}
+
+static void
+test_slider_drag (void)
+{
+  gdouble direct, cached;
+
+  if (!g_test_perf ())
+    return;
+
+  direct = drag_slider (FALSE);
+  cached = drag_slider (TRUE);
+
+  g_test_maximized_result (direct, "slider drag, direct: %.0f frames per second", direct);
+  g_test_maximized_result (cached, "slider drag, cached: %.0f frames per second", cached);
+
+  g_assert_cmpfloat (cached, >=, direct / CACHED_MAX_RATIO);
+}
+
+static void
+bench_primitive (gpointer data)
+{
+  const Bench *bench = data;
+
+  quartz_cache_set_disabled (!bench->cached);
+  bench->primitive->draw (pixmap);
+}
+
+static gchar *
+get_bench_path (const Primitive *primitive,
+                gboolean         cached)
+{
+  return g_strdup_printf ("/render/bench/%s-%s", primitive->name,
+                          cached ? "cached" : "direct");
+}
+
+/* The cached ones are gated on the direct ones. */
+static void
+add_bench (const Primitive *primitive,
+           gboolean         cached)
+{
+  Bench *bench;
+  gchar *path, *direct_path;
+
+  bench = g_new (Bench, 1);
+  bench->primitive = primitive;
+  bench->cached = cached;
+
+  path = get_bench_path (primitive, cached);
+  direct_path = get_bench_path (primitive, FALSE);
+
+  if (cached)
+    quartz_test_add_bench_gated (path, bench_primitive, bench,
+                                 direct_path, CACHED_MAX_RATIO);
+  else
+    quartz_test_add_bench (path, bench_primitive, bench);
+
+  g_free (path);
+  g_free (direct_path);
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *path;
+  gint i;
+
+  quartz_test_init (&argc, &argv);
+  gtk_init (&argc, &argv);
+
+  pixmap = gdk_pixmap_new (NULL, WIDTH, HEIGHT, gdk_visual_get_best_depth ());
+  gdk_drawable_set_colormap (pixmap, gdk_colormap_get_system ());
+
+  for (i = 0; i < G_N_ELEMENTS (primitives); i++)
+    {
+      path = g_strdup_printf ("/render/%s", primitives[i].name);
+      g_test_add_data_func (path, &primitives[i], test_primitive);
+      g_free (path);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (primitives); i++)
+    {
+      add_bench (&primitives[i], FALSE);
+      add_bench (&primitives[i], TRUE);
+    }
+
+  g_test_add_func ("/render/no-allocations", test_no_allocations);
+  g_test_add_func ("/render/cold-start", test_cold_start);
+  g_test_add_func ("/render/slider-drag", test_slider_drag);
+  quartz_test_add_bench ("/render/bench/cold-start-empty", bench_cold_start_empty, NULL);
+  quartz_test_add_bench ("/render/bench/cold-start-prerender", bench_cold_start_prerender, NULL);
+
+  return quartz_test_run ();
+}
@@ -0,0 +1,550 @@
+/* GTK+ theme engine for the Quartz backend
+ *
+ * Copyright (C) 2013 Xamarin Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Draws through the GtkStyle vfuncs of the engine, for a matrix of
+ * widget type and detail, state, shadow and size, into a pixmap, and
+ * compares every image with its reference in reference/. Run with
+ * QUARTZ_TEST_UPDATE_REFERENCES=1 to write the references instead,
+ * after checking that a change really is meant to look different.
+ *
+ * With -m perf each case is timed with the render cache on and off,
+ * and the cached run is gated on the direct one. The push button path
+ * of quartz_draw_button() is also timed with and without the
+ * gtk_widget_style_get() of focus-line-width it used to do on every
+ * draw, which the per-type table on the style now stands in for.
+ *
+ * Also with -m perf, a window with a toolbar and an event box is
+ * resized through a range of sizes, drawing each frame, once as usual
+ * and once as if the user was dragging its edge. The frames per second
+ * of both are reported, and the live resize ones may not be lower.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <gtk/gtk.h>
+#include <Carbon/Carbon.h>
+
+#include "quartz-cache.h"
+#include "quartz-draw.h"
+#include "quartz-style.h"
+#include "driver.h"
+#include "engine.h"
+
+#define WIDTH   240
+#define HEIGHT  48
+#define PADDING 8
+
+/* How far a channel may be off before a pixel counts as different,
+ * and how many pixels may differ.
+ */
+#define TOLERANCE    16
+#define MAX_MISMATCH 1
+
+#define CACHED_MAX_RATIO 1.0
+#define TABLE_MAX_RATIO  1.0
+
+/* The window grows from its smallest size by RESIZE_STEP pixels at a
+ * time, N_RESIZE_STEPS times, like a drag of the corner would.
+ */
+#define RESIZE_MIN_WIDTH  300
+#define RESIZE_MIN_HEIGHT 200
+#define RESIZE_STEP       4
+#define N_RESIZE_STEPS    100
+
+typedef enum
+{
+  PAINT_BOX,
+  PAINT_CHECK,
+  PAINT_OPTION,
+  PAINT_SHADOW,
+  PAINT_ARROW,
+  PAINT_EXTENSION,
+  PAINT_FLAT_BOX,
+  PAINT_FOCUS
+} Paint;
+
+typedef struct
+{
+  gint width;
+  gint height;
+} Size;
+
+typedef struct
+{
+  const gchar  *name;
+  Paint         paint;
+  GType       (*get_type) (void);
+  const gchar  *detail;
+  Size          sizes[2];
+} Case;
+
+typedef struct
+{
+  const Case *test_case;
+  gboolean    cached;
+} Bench;
+
+/* The second size of a button is small enough to be drawn as a bevel. */
+static const Case cases[] = {
+  { "button",          PAINT_BOX,       gtk_button_get_type,        "button",          { { 85, 27 }, { 16, 16 } } },
+  { "button-default",  PAINT_BOX,       gtk_button_get_type,        "buttondefault",   { { 85, 27 }, { 120, 32 } } },
+  { "check-button",    PAINT_CHECK,     gtk_check_button_get_type,  "checkbutton",     { { 13, 13 }, { 16, 16 } } },
+  { "cell-check",      PAINT_CHECK,     gtk_tree_view_get_type,     "cellcheck",       { { 13, 13 }, { 16, 16 } } },
+  { "radio-button",    PAINT_OPTION,    gtk_radio_button_get_type,  "radiobutton",     { { 13, 13 }, { 16, 16 } } },
+  { "entry",           PAINT_SHADOW,    gtk_entry_get_type,         "entry",           { { 120, 22 }, { 60, 30 } } },
+  { "arrow",           PAINT_ARROW,     gtk_arrow_get_type,         NULL,              { { 10, 10 }, { 16, 16 } } },
+  { "notebook-tab",    PAINT_EXTENSION, gtk_notebook_get_type,      "tab",             { { 80, 22 }, { 120, 22 } } },
+  { "scrollbar",       PAINT_BOX,       gtk_hscrollbar_get_type,    "trough",          { { 200, 15 }, { 100, 15 } } },
+  { "scale",           PAINT_BOX,       gtk_hscale_get_type,        "trough",          { { 200, 21 }, { 100, 21 } } },
+  { "progress-bar",    PAINT_BOX,       gtk_progress_bar_get_type,  "trough",          { { 200, 20 }, { 100, 20 } } },
+  { "tree-view-cell",  PAINT_FLAT_BOX,  gtk_tree_view_get_type,     "cell_even",       { { 200, 18 }, { 100, 18 } } },
+  { "entry-focus",     PAINT_FOCUS,     gtk_entry_get_type,         "entry",           { { 120, 22 }, { 60, 30 } } }
+};
+
+static const GtkStateType states[] = {
+  GTK_STATE_NORMAL, GTK_STATE_ACTIVE, GTK_STATE_PRELIGHT,
+  GTK_STATE_SELECTED, GTK_STATE_INSENSITIVE
+};
+
+static const GtkShadowType shadows[] = {
+  GTK_SHADOW_OUT, GTK_SHADOW_IN
+};
+
+static GdkPixmap *pixmap = NULL;
+static GtkStyle  *style = NULL;
+
+static const gchar *
+get_nick (GType type,
+          gint  value)
+{
+  GEnumClass *klass;
+  const gchar *nick;
+
+  klass = g_type_class_ref (type);
+  nick = g_enum_get_value (klass, value)->value_nick;
+  g_type_class_unref (klass);
+
+  return nick;
+}
+
+static void
+clear (void)
+{
+  cairo_t *cr;
+
+  cr = gdk_cairo_create (pixmap);
+  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+}
+
+static void
+paint (const Case    *test_case,
+       GtkWidget     *widget,
+       GtkStateType   state,
+       GtkShadowType  shadow,
+       const Size    *size)
+{
+  GtkAllocation allocation = { PADDING, PADDING, size->width, size->height };
+  GdkWindow *window = (GdkWindow *) pixmap;
+  const gchar *detail = test_case->detail;
+
+  gtk_widget_size_allocate (widget, &allocation);
+
+  switch (test_case->paint)
+    {
+    case PAINT_BOX:
+      gtk_paint_box (style, window, state, shadow, NULL, widget, detail,
+                     PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_CHECK:
+      gtk_paint_check (style, window, state, shadow, NULL, widget, detail,
+                       PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_OPTION:
+      gtk_paint_option (style, window, state, shadow, NULL, widget, detail,
+                        PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_SHADOW:
+      gtk_paint_shadow (style, window, state, shadow, NULL, widget, detail,
+                        PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_ARROW:
+      gtk_paint_arrow (style, window, state, shadow, NULL, widget, detail,
+                       GTK_ARROW_DOWN, TRUE,
+                       PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_EXTENSION:
+      gtk_paint_extension (style, window, state, shadow, NULL, widget, detail,
+                           PADDING, PADDING, size->width, size->height,
+                           GTK_POS_BOTTOM);
+      break;
+
+    case PAINT_FLAT_BOX:
+      gtk_paint_flat_box (style, window, state, shadow, NULL, widget, detail,
+                          PADDING, PADDING, size->width, size->height);
+      break;
+
+    case PAINT_FOCUS:
+      gtk_paint_focus (style, window, state, NULL, widget, detail,
+                       PADDING, PADDING, size->width, size->height);
+      break;
+    }
+}
+
+static GtkWidget *
+create_widget (const Case *test_case)
+{
+  return g_object_ref_sink (g_object_new (test_case->get_type (), NULL));
+}
+
+static gint
+count_mismatches (GdkPixbuf *a,
+                  GdkPixbuf *b)
+{
+  const guchar *pa, *pb;
+  gint x, y, c, n_channels;
+  gint mismatches = 0;
+
+  n_channels = gdk_pixbuf_get_n_channels (a);
+
+  for (y = 0; y < HEIGHT; y++)
+    {
+      pa = gdk_pixbuf_get_pixels (a) + y * gdk_pixbuf_get_rowstride (a);
+      pb = gdk_pixbuf_get_pixels (b) + y * gdk_pixbuf_get_rowstride (b);
+
+      for (x = 0; x < WIDTH; x++)
+        {
+          for (c = 0; c < n_channels; c++)
+            if (abs (pa[c] - pb[c]) > TOLERANCE)
+              break;
+
+          if (c < n_channels)
+            mismatches++;
+
+          pa += n_channels;
+          pb += n_channels;
+        }
+    }
+
+  return mismatches;
+}
+
+static void
+check_reference (const gchar *name,
+                 GdkPixbuf   *image)
+{
+  GdkPixbuf *reference;
+  GError *error = NULL;
+  gchar *filename;
+  gint mismatches;
+
+  filename = g_strdup_printf ("%s/%s.png", REFERENCE_DIR, name);
+
+  if (g_getenv ("QUARTZ_TEST_UPDATE_REFERENCES"))
+    {
+      gdk_pixbuf_save (image, filename, "png", &error, NULL);
+      g_assert_no_error (error);
+      g_free (filename);
+      return;
+    }
+
+  reference = gdk_pixbuf_new_from_file (filename, NULL);
+  if (!reference)
+    {
+      g_test_message ("%s: no reference image", name);
+      g_free (filename);
+      return;
+    }
+
+  g_assert_cmpint (gdk_pixbuf_get_n_channels (reference), ==, gdk_pixbuf_get_n_channels (image));
+
+  mismatches = count_mismatches (reference, image);
+  if (mismatches * 100 > MAX_MISMATCH * WIDTH * HEIGHT)
+    {
+      g_test_message ("%s: %d of %d pixels differ from %s", name,
+                      mismatches, WIDTH * HEIGHT, filename);
+      g_test_fail ();
+    }
+
+  g_object_unref (reference);
+  g_free (filename);
+}
+
+static void
+test_style_case (gconstpointer data)
+{
+  const Case *test_case = data;
+  GtkWidget *widget;
+  GdkPixbuf *image;
+  gchar *name;
+  gint i, j, k;
+
+  quartz_cache_set_disabled (FALSE);
+  widget = create_widget (test_case);
+
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    for (j = 0; j < G_N_ELEMENTS (shadows); j++)
+      for (k = 0; k < G_N_ELEMENTS (test_case->sizes); k++)
+        {
+          const Size *size = &test_case->sizes[k];
+
+          clear ();
+          paint (test_case, widget, states[i], shadows[j], size);
+          image = gdk_pixbuf_get_from_drawable (NULL, pixmap, NULL, 0, 0, 0, 0, WIDTH, HEIGHT);
+
+          name = g_strdup_printf ("%s-%s-%s-%dx%d", test_case->name,
+                                  get_nick (GTK_TYPE_STATE_TYPE, states[i]),
+                                  get_nick (GTK_TYPE_SHADOW_TYPE, shadows[j]),
+                                  size->width, size->height);
+          check_reference (name, image);
+
+          g_free (name);
+          g_object_unref (image);
+        }
+
+  g_object_unref (widget);
+}
+
+static void
+bench_case (gpointer data)
+{
+  const Bench *bench = data;
+  const Case *test_case = bench->test_case;
+  GtkWidget *widget;
+  gint i, j, k;
+
+  quartz_cache_set_disabled (!bench->cached);
+  widget = create_widget (test_case);
+
+  for (i = 0; i < G_N_ELEMENTS (states); i++)
+    for (j = 0; j < G_N_ELEMENTS (shadows); j++)
+      for (k = 0; k < G_N_ELEMENTS (test_case->sizes); k++)
+        paint (test_case, widget, states[i], shadows[j], &test_case->sizes[k]);
+
+  g_object_unref (widget);
+}
+
+static gchar *
+get_bench_path (const Case *test_case,
+                gboolean    cached)
+{
+  return g_strdup_printf ("/style/bench/%s-%s", test_case->name,
+                          cached ? "cached" : "direct");
+}
+
+static void
+add_bench (const Case *test_case,
+           gboolean    cached)
+{
+  Bench *bench;
+  gchar *path, *direct_path;
+
+  bench = g_new (Bench, 1);
+  bench->test_case = test_case;
+  bench->cached = cached;
+
+  path = get_bench_path (test_case, cached);
+  direct_path = get_bench_path (test_case, FALSE);
+
+  if (cached)
+    quartz_test_add_bench_gated (path, bench_case, bench,
+                                 direct_path, CACHED_MAX_RATIO);
+  else
+    quartz_test_add_bench (path, bench_case, bench);
+
+  g_free (path);
+  g_free (direct_path);
+}
+
+static void
+test_focus_line_width (gconstpointer data)
+{
+  GtkWidget *button = (GtkWidget *) data;
+  gint line_width;
+
+  gtk_widget_style_get (button,
+                        "focus-line-width", &line_width,
+                        NULL);
+
+  /* Once to fill the table, once from it. */
+  g_assert_cmpint (quartz_style_get_focus_line_width (style, button), ==, line_width);
+  g_assert_cmpint (quartz_style_get_focus_line_width (style, button), ==, line_width);
+}
+
+static void
+set_style (GtkWidget *widget,
+           gpointer   data)
+{
+  gtk_widget_set_style (widget, style);
+
+  if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget), set_style, NULL);
+}
+
+static void
+flush (void)
+{
+  gdk_window_process_all_updates ();
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+}
+
+/* Frames per second over one resize of window. */
+static gdouble
+resize_window (GtkWidget *window,
+               gboolean   live)
+{
+  GTimer *timer;
+  gdouble elapsed;
+  gint i;
+
+  quartz_draw_set_live_resize_forced (live);
+
+  gtk_window_resize (GTK_WINDOW (window), RESIZE_MIN_WIDTH, RESIZE_MIN_HEIGHT);
+  flush ();
+
+  timer = g_timer_new ();
+  for (i = 1; i <= N_RESIZE_STEPS; i++)
+    {
+      gtk_window_resize (GTK_WINDOW (window),
+                         RESIZE_MIN_WIDTH + i * RESIZE_STEP,
+                         RESIZE_MIN_HEIGHT + i * RESIZE_STEP);
+      flush ();
+    }
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  quartz_draw_set_live_resize_forced (FALSE);
+
+  return N_RESIZE_STEPS / elapsed;
+}
+
+static void
+test_live_resize (void)
+{
+  GtkWidget *window, *box, *toolbar, *event_box;
+  gdouble normal, live;
+
+  if (!g_test_perf ())
+    return;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  box = gtk_vbox_new (FALSE, 0);
+  toolbar = gtk_toolbar_new ();
+  event_box = gtk_event_box_new ();
+
+  gtk_toolbar_insert (GTK_TOOLBAR (toolbar), gtk_tool_button_new (NULL, "Button"), -1);
+  gtk_box_pack_start (GTK_BOX (box), toolbar, FALSE, FALSE, 0);
+  gtk_box_pack_start (GTK_BOX (box), event_box, TRUE, TRUE, 0);
+  gtk_container_add (GTK_CONTAINER (window), box);
+  set_style (window, NULL);
+
+  gtk_widget_show_all (window);
+  flush ();
+
+  /* The strips the live run draws from are rendered by its first frame. */
+  normal = resize_window (window, FALSE);
+  live = resize_window (window, TRUE);
+
+  g_test_maximized_result (normal, "resize: %.0f frames per second", normal);
+  g_test_maximized_result (live, "live resize: %.0f frames per second", live);
+
+  g_assert_cmpfloat (live, >=, normal);
+
+  gtk_widget_destroy (window);
+}
+
+/* Costs what quartz_draw_button() did before the table: the style
+ * property read on every draw, on top of the draw itself.
+ */
+static void
+bench_button_style_get (gpointer data)
+{
+  GtkWidget *button = data;
+  gint line_width;
+
+  gtk_widget_style_get (button,
+                        "focus-line-width", &line_width,
+                        NULL);
+
+  quartz_draw_button (style, (GdkWindow *) pixmap, GTK_STATE_NORMAL, GTK_SHADOW_OUT,
+                      button, "button", NULL, kThemePushButton,
+                      PADDING, PADDING, 85, 27);
+}
+
+static void
+bench_button (gpointer data)
+{
+  GtkWidget *button = data;
+
+  quartz_draw_button (style, (GdkWindow *) pixmap, GTK_STATE_NORMAL, GTK_SHADOW_OUT,
+                      button, "button", NULL, kThemePushButton,
+                      PADDING, PADDING, 85, 27);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *button;
+  gchar *path;
+  gint i;
+
+  quartz_test_init (&argc, &argv);
+  gtk_init (&argc, &argv);
+
+  pixmap = gdk_pixmap_new (NULL, WIDTH, HEIGHT, gdk_visual_get_best_depth ());
+  gdk_drawable_set_colormap (pixmap, gdk_colormap_get_system ());
+
+  style = gtk_style_attach (quartz_test_init_engine (), (GdkWindow *) pixmap);
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      path = g_strdup_printf ("/style/%s", cases[i].name);
+      g_test_add_data_func (path, &cases[i], test_style_case);
+      g_free (path);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      add_bench (&cases[i], FALSE);
+      add_bench (&cases[i], TRUE);
+    }
+
+  /* The table is only used for widgets that have the style. */
+  button = g_object_ref_sink (gtk_button_new ());
+  gtk_widget_set_style (button, style);
+
+  g_test_add_data_func ("/style/focus-line-width", button, test_focus_line_width);
+  g_test_add_func ("/style/live-resize", test_live_resize);
+
+  quartz_test_add_bench ("/style/bench/draw-button-style-get",
+                         bench_button_style_get, button);
+  quartz_test_add_bench_gated ("/style/bench/draw-button",
+                               bench_button, button,
+                               "/style/bench/draw-button-style-get", TABLE_MAX_RATIO);
+
+  return quartz_test_run ();
+}